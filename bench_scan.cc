@@ -0,0 +1,139 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// time one scan backend, for tools/bench_scan.py:
+// bench-scan is built with plocate.o, bench-scanold with mlocate.o
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <getopt.h>
+#include <sys/resource.h>
+
+#include "locate.h"
+#include "nolocate.h"
+
+using namespace std;
+
+struct io_counters
+{
+	long long syscr = 0;
+	long long syscw = 0;
+};
+
+// the read and write system calls, the only ones the kernel counts per process
+static io_counters read_io()
+{
+	io_counters io;
+	ifstream proc("/proc/self/io");
+	string key;
+	long long value;
+	while (proc >> key >> value) {
+		if (key == "syscr:") io.syscr = value;
+		else if (key == "syscw:") io.syscw = value;
+	}
+	return io;
+}
+
+static long ms(const timeval& tv)
+{
+	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static void usage()
+{
+	cout << "usage: bench-scan [options] locate|nolocate\n\n";
+	cout << "    -I --ignore      ignore file (default: /etc/cruft/ignore)\n";
+	cout << "    -r --root        root directory, for nolocate (default: /)\n";
+	cout << "    -o --output      write the scanned paths to this file\n";
+	cout << "    -h --help        this help\n";
+}
+
+int main(int argc, char *argv[])
+{
+	string ignore_file = "/etc/cruft/ignore";
+	string root_dir = "/";
+	string output_file;
+
+	static struct option long_options[] =
+	{
+		{"ignore", required_argument, nullptr, 'I'},
+		{"root", required_argument, nullptr, 'r'},
+		{"output", required_argument, nullptr, 'o'},
+		{"help", no_argument, nullptr, 'h'},
+		{nullptr, 0, nullptr, 0}
+	};
+	int opt;
+	while ((opt = getopt_long(argc, argv, "I:r:o:h", long_options, nullptr)) != -1) {
+		switch (opt) {
+		case 'I':
+			ignore_file = optarg;
+			break;
+		case 'r':
+			root_dir = optarg;
+			if (root_dir.empty() || root_dir.back() != '/')
+				root_dir += '/';
+			break;
+		case 'o':
+			output_file = optarg;
+			break;
+		case 'h':
+			usage();
+			exit(0);
+		default:
+			usage();
+			exit(1);
+		}
+	}
+	if (optind + 1 != argc) {
+		usage();
+		exit(1);
+	}
+	string backend = argv[optind];
+	if (backend != "locate" && backend != "nolocate") {
+		cerr << "unknown backend " << backend << '\n';
+		exit(1);
+	}
+
+	vector<string> fs;
+	struct rusage self_before, children_before, self, children;
+	io_counters io_before = read_io();
+	getrusage(RUSAGE_SELF, &self_before);
+	getrusage(RUSAGE_CHILDREN, &children_before);
+	auto start = chrono::steady_clock::now();
+
+	int rc = (backend == "locate" ? read_locate : read_nolocate)(fs, ignore_file, root_dir);
+
+	auto end = chrono::steady_clock::now();
+	getrusage(RUSAGE_SELF, &self);
+	getrusage(RUSAGE_CHILDREN, &children);
+	io_counters io = read_io();
+
+	if (!output_file.empty()) {
+		ofstream out(output_file);
+		for (const auto& path: fs)
+			out << path << '\n';
+		if (!out.flush()) {
+			cerr << "cannot write " << output_file << '\n';
+			exit(1);
+		}
+	}
+
+	// plocate runs as a child, its costs are the children's
+	cout << "{\"backend\":\"" << backend << "\""
+	     << ",\"rc\":" << rc
+	     << ",\"paths\":" << fs.size()
+	     << ",\"wall_ms\":" << chrono::duration_cast<chrono::milliseconds>(end - start).count()
+	     << ",\"user_ms\":" << ms(self.ru_utime) - ms(self_before.ru_utime)
+	     << ",\"sys_ms\":" << ms(self.ru_stime) - ms(self_before.ru_stime)
+	     << ",\"children_user_ms\":" << ms(children.ru_utime) - ms(children_before.ru_utime)
+	     << ",\"children_sys_ms\":" << ms(children.ru_stime) - ms(children_before.ru_stime)
+	     << ",\"max_rss_kb\":" << self.ru_maxrss
+	     << ",\"children_max_rss_kb\":" << children.ru_maxrss
+	     << ",\"read_syscalls\":" << io.syscr - io_before.syscr
+	     << ",\"write_syscalls\":" << io.syscw - io_before.syscw
+	     << ",\"voluntary_switches\":" << self.ru_nvcsw - self_before.ru_nvcsw
+	     << ",\"involuntary_switches\":" << self.ru_nivcsw - self_before.ru_nivcsw
+	     << "}\n";
+	return rc;
+}
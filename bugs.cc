@@ -1,13 +1,23 @@
 // Copyright © 2022 Alexandre Detiste <alexandre@detiste.be>
 // SPDX-License-Identifier: GPL-2.0-or-later
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <map>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "counters.h"
 #include "owner.h"
 #include "bugs.h"
+#include "hash.h"
+#include "shellexp.h"
 
 using namespace std;
 
@@ -37,6 +47,7 @@ void read_bugs(map<string, bug>& bugs, const string& bugs_path)
 
 	for (string bugs_line; getline(bugs_file, bugs_line);)
 	{
+		count_op(op_file_bytes, bugs_line.size() + 1);
 		if (bugs_line.empty()) continue;
 		stringstream ss (bugs_line);
 		string path, bug_nr, package;
@@ -48,8 +59,238 @@ void read_bugs(map<string, bug>& bugs, const string& bugs_path)
 	}
 }
 
+static bool is_glob(const string& path)
+{
+	return path.find_first_of("*?[") != string::npos;
+}
+
+/* the index is:
+     header
+     hash table        uint32 per slot, offset + 1 of the record, 0 if empty
+     glob table        uint32 per glob entry, offset of the record
+     records           "path\0bugno\0package\0" each
+   open addressing with linear probing on the FNV-1a hash of the path,
+   the table is at most half full; integers are in host byte order */
+struct bugs_index_header
+{
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t version;
+	uint64_t entries;
+	uint64_t slots;
+	uint64_t globs;
+	uint64_t table;
+	uint64_t glob_table;
+	uint64_t records;
+	uint64_t end;
+};
+
+static const char index_magic[8] = {'C', 'R', 'U', 'F', 'T', 'B', 'U', 'G'};
+static const uint32_t index_byte_order = 0x01020304;
+static const uint32_t index_version = 1;
+
+bool write_bugs_index(const string& bugs_path, const string& index_path)
+{
+	map<string, bug> bugs;
+	read_bugs(bugs, bugs_path);
+
+	bugs_index_header h{};
+	memcpy(h.magic, index_magic, sizeof(index_magic));
+	h.byte_order = index_byte_order;
+	h.version = index_version;
+	h.slots = 16;
+	for (const auto& b: bugs)
+		if (!is_glob(b.first)) h.entries++;
+	while (h.slots < 2 * h.entries)
+		h.slots *= 2;
+
+	string records;
+	vector<uint32_t> table(h.slots, 0);
+	vector<uint32_t> glob_table;
+	for (const auto& b: bugs) {
+		uint32_t offset = records.size();
+		records += b.first + '\0' + b.second.bugno + '\0' + b.second.package + '\0';
+		if (is_glob(b.first)) {
+			glob_table.push_back(offset);
+			continue;
+		}
+		uint64_t slot = fnv1a(b.first) & (h.slots - 1);
+		while (table[slot])
+			slot = (slot + 1) & (h.slots - 1);
+		table[slot] = offset + 1;
+	}
+	h.globs = glob_table.size();
+	h.table = sizeof(h);
+	h.glob_table = h.table + h.slots * sizeof(uint32_t);
+	h.records = h.glob_table + h.globs * sizeof(uint32_t);
+	h.end = h.records + records.size();
+
+	string tmp = index_path + ".tmp";
+	ofstream out(tmp, ios::binary | ios::trunc);
+	out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+	out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(uint32_t));
+	out.write(reinterpret_cast<const char*>(glob_table.data()), glob_table.size() * sizeof(uint32_t));
+	out << records;
+	out.close();
+	if (!out || rename(tmp.c_str(), index_path.c_str()) != 0) {
+		cerr << "cannot write " << index_path << ": " << strerror(errno) << '\n';
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+known_bugs::known_bugs(string bugs_path_) : bugs_path(std::move(bugs_path_))
+{
+}
+
+known_bugs::~known_bugs()
+{
+	if (base)
+		munmap(const_cast<char*>(base), length);
+}
+
+bool known_bugs::map_index(const string& index_path)
+{
+	struct stat text, index;
+	if (stat(bugs_path.c_str(), &text) != 0 || stat(index_path.c_str(), &index) != 0
+	    || index.st_mtim.tv_sec < text.st_mtim.tv_sec || size_t(index.st_size) < sizeof(bugs_index_header))
+		return false;
+
+	int fd = open(index_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	void* map = mmap(nullptr, index.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	base = static_cast<const char*>(map);
+	length = index.st_size;
+
+	const bugs_index_header* h = reinterpret_cast<const bugs_index_header*>(base);
+	bool ok = memcmp(h->magic, index_magic, sizeof(index_magic)) == 0
+	       && h->byte_order == index_byte_order && h->version == index_version
+	       && h->slots && (h->slots & (h->slots - 1)) == 0 && h->entries < h->slots
+	       && h->table == sizeof(*h) && h->glob_table == h->table + h->slots * 4
+	       && h->records == h->glob_table + h->globs * 4 && h->end == length
+	       && (h->end == h->records || base[h->end - 1] == '\0');
+	if (!ok) {
+		cerr << index_path << " is corrupted, using " << bugs_path << '\n';
+		munmap(const_cast<char*>(base), length);
+		base = nullptr;
+		return false;
+	}
+	header = h;
+	return true;
+}
+
+void known_bugs::load()
+{
+	if (!map_index(bugs_path + ".idx")) {
+		map<string, bug> all;
+		read_bugs(all, bugs_path);
+		for (auto& b: all) {
+			if (is_glob(b.first))
+				globs.emplace_back(b.first, b.second);
+			else
+				bugs.emplace(b.first, b.second);
+		}
+	}
+	done = true;
+}
+
+// the record at 'offset' in the index, 'found' may be null to only read its path
+bool known_bugs::record(uint64_t offset, string& path, bug* found) const
+{
+	const char* pos = base + header->records + offset;
+	const char* end = base + header->end;
+	string* fields[3] = {&path, found ? &found->bugno : nullptr, found ? &found->package : nullptr};
+	for (auto field: fields) {
+		if (pos >= end)
+			return false;
+		const char* zero = static_cast<const char*>(memchr(pos, '\0', end - pos));
+		if (!zero)
+			return false;
+		if (field)
+			field->assign(pos, zero - pos);
+		pos = zero + 1;
+	}
+	return true;
+}
+
+bool known_bugs::find(const string& path, bug& found)
+{
+	call_once(once, [this] { load(); });
+
+	if (!header) {
+		auto exact = bugs.find(path);
+		if (exact != bugs.end()) {
+			found = exact->second;
+			return true;
+		}
+		for (const auto& glob: globs)
+			if (myglob(path, glob.first)) {
+				found = glob.second;
+				return true;
+			}
+		return false;
+	}
+
+	const uint32_t* table = reinterpret_cast<const uint32_t*>(base + header->table);
+	string candidate;
+	for (uint64_t slot = fnv1a(path) & (header->slots - 1), probes = 0;
+	     table[slot] && probes < header->slots; slot = (slot + 1) & (header->slots - 1), probes++) {
+		if (record(table[slot] - 1, candidate, nullptr) && candidate == path)
+			return record(table[slot] - 1, candidate, &found);
+	}
+
+	const uint32_t* glob_table = reinterpret_cast<const uint32_t*>(base + header->glob_table);
+	for (uint64_t i = 0; i < header->globs; i++)
+		if (record(glob_table[i], candidate, nullptr) && myglob(path, candidate))
+			return record(glob_table[i], candidate, &found);
+	return false;
+}
+
+size_t known_bugs::size() const
+{
+	return header ? header->entries + header->globs : bugs.size() + globs.size();
+}
+
+void known_bugs::entries(vector<pair<string, bug>>& all)
+{
+	call_once(once, [this] { load(); });
+
+	if (!header) {
+		all.insert(all.end(), bugs.begin(), bugs.end());
+		all.insert(all.end(), globs.begin(), globs.end());
+	} else {
+		const uint32_t* table = reinterpret_cast<const uint32_t*>(base + header->table);
+		const uint32_t* glob_table = reinterpret_cast<const uint32_t*>(base + header->glob_table);
+		string path;
+		bug found("", "");
+		for (uint64_t slot = 0; slot < header->slots; slot++)
+			if (table[slot] && record(table[slot] - 1, path, &found))
+				all.emplace_back(path, found);
+		for (uint64_t i = 0; i < header->globs; i++)
+			if (record(glob_table[i], path, &found))
+				all.emplace_back(path, found);
+	}
+	sort(all.begin(), all.end(), [](const pair<string, bug>& a, const pair<string, bug>& b) { return a.first < b.first; });
+}
+
+void known_bugs::replace(const vector<pair<string, bug>>& all)
+{
+	call_once(once, [this] { done = true; });
+	for (const auto& b: all) {
+		if (is_glob(b.first))
+			globs.emplace_back(b.first, b.second);
+		else
+			bugs.emplace(b.first, b.second);
+	}
+}
+
 #ifdef UNIT_TEST
-//clang++ -DUNIT_TEST bugs.cc owner.cc -o test_bugs && ./test_bugs
+//clang++ -DUNIT_TEST bugs.cc owner.cc shellexp.cc -o test_bugs && ./test_bugs
 int main()
 {
 	map<string, bug> bugs;
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 struct bug
 {
@@ -13,3 +17,48 @@ struct bug
 bool operator<(bug const&, bug const&);
 
 void read_bugs(std::map<std::string, bug>& bugs, const std::string& bugs_path);
+
+struct bugs_index_header;
+
+/* the known bugs, only read on the first lookup: from the hash index
+   "<bugs_path>.idx" written by write_bugs_index() when it is not older
+   than bugs_path, else from bugs_path itself;
+   entries whose path is a glob cover all the paths it matches */
+class known_bugs
+{
+public:
+	explicit known_bugs(std::string bugs_path);
+	~known_bugs();
+	known_bugs(const known_bugs&) = delete;
+	known_bugs& operator=(const known_bugs&) = delete;
+
+	// false if no bug is known for this path
+	bool find(const std::string& path, bug& found);
+	bool loaded() const { return done; }
+	size_t size() const;
+
+	// all the known bugs, by path, for --record
+	void entries(std::vector<std::pair<std::string, bug>>& all);
+	// use these instead of reading bugs_path, for --replay
+	void replace(const std::vector<std::pair<std::string, bug>>& all);
+
+private:
+	void load();
+	bool map_index(const std::string& index_path);
+	bool record(uint64_t offset, std::string& path, bug* found) const;
+
+	std::string bugs_path;
+	std::once_flag once;
+	bool done = false;
+
+	// from the index
+	const char* base = nullptr;
+	size_t length = 0;
+	const bugs_index_header* header = nullptr;
+
+	// from the text file
+	std::map<std::string, bug> bugs;
+	std::vector<std::pair<std::string, bug>> globs;
+};
+
+bool write_bugs_index(const std::string& bugs_path, const std::string& index_path);
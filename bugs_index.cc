@@ -0,0 +1,18 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <iostream>
+
+#include "bugs.h"
+
+using namespace std;
+
+// build time helper: bugs -> bugs.idx
+int main(int argc, char *argv[])
+{
+	if (argc != 3) {
+		cerr << "usage: bugs-index BUGS INDEX\n";
+		return 1;
+	}
+	return write_bugs_index(argv[1], argv[2]) ? 0 : 1;
+}
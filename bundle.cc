@@ -0,0 +1,102 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+#include "bundle.h"
+
+using namespace std;
+
+static const char header[] = "cruft-bundle 1";
+
+void bundle::put(const string& section, const vector<string>& records)
+{
+	sections[section] = records;
+}
+
+// package and path, one after the other
+void bundle::put(const string& section, const vector<owner>& owners)
+{
+	auto& records = sections[section];
+	records.clear();
+	for (const auto& o: owners) {
+		records.push_back(o.package);
+		records.push_back(o.path);
+	}
+}
+
+bool bundle::get(const string& section, vector<string>& records) const
+{
+	auto found = sections.find(section);
+	if (found == sections.end())
+		return false;
+	records = found->second;
+	return true;
+}
+
+bool bundle::get(const string& section, vector<owner>& owners) const
+{
+	auto found = sections.find(section);
+	if (found == sections.end() || found->second.size() % 2)
+		return false;
+	for (size_t i = 0; i < found->second.size(); i += 2)
+		owners.emplace_back(found->second[i], found->second[i + 1]);
+	return true;
+}
+
+bool bundle::write(const string& file) const
+{
+	// written next to the target, then renamed over it
+	string tmp = file + ".tmp";
+	ofstream out(tmp, ios::binary | ios::trunc);
+	out << header << '\n';
+	for (const auto& section: sections) {
+		out << section.first << ' ' << section.second.size() << '\n';
+		for (const auto& record: section.second)
+			out << record << '\0';
+	}
+	out.close();
+	if (!out || rename(tmp.c_str(), file.c_str()) != 0) {
+		cerr << "cannot write " << file << ": " << strerror(errno) << '\n';
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool bundle::read(const string& file)
+{
+	ifstream in(file, ios::binary);
+	if (!in) {
+		cerr << "cannot open " << file << ": " << strerror(errno) << '\n';
+		return false;
+	}
+	string line;
+	if (!getline(in, line) || line != header) {
+		cerr << file << ": not a cruft bundle\n";
+		return false;
+	}
+	sections.clear();
+	while (getline(in, line)) {
+		size_t space = line.rfind(' ');
+		char* end = nullptr;
+		unsigned long long count = space == string::npos ? 0 : strtoull(line.c_str() + space + 1, &end, 10);
+		if (space == string::npos || *end != '\0') {
+			cerr << file << ": corrupted at section " << line << '\n';
+			return false;
+		}
+		auto& records = sections[line.substr(0, space)];
+		string record;
+		for (unsigned long long i = 0; i < count; i++) {
+			if (!getline(in, record, '\0')) {
+				cerr << file << ": truncated in section " << line.substr(0, space) << '\n';
+				return false;
+			}
+			records.push_back(std::move(record));
+		}
+	}
+	return true;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "owner.h"
+
+/* everything cruft reads from the system, saved by --record and
+   read back by --replay; the file is
+
+     cruft-bundle 1
+     <section> <count>
+     <count records, each ended by '\0'>
+     ...
+
+   so paths with any byte but '\0' are kept as they are */
+class bundle
+{
+public:
+	void put(const std::string& section, const std::vector<std::string>& records);
+	void put(const std::string& section, const std::vector<owner>& owners);
+	// false if the section is not there
+	bool get(const std::string& section, std::vector<std::string>& records) const;
+	bool get(const std::string& section, std::vector<owner>& owners) const;
+
+	// false, with a message on stderr, on failure
+	bool write(const std::string& file) const;
+	bool read(const std::string& file);
+
+private:
+	std::map<std::string, std::vector<std::string>> sections;
+};
@@ -0,0 +1,115 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <unordered_set>
+#include <sys/stat.h>
+
+#include "collapse.h"
+#include "counters.h"
+
+using namespace std;
+
+namespace {
+
+struct frame
+{
+	const string* path;
+	bool all;          // this entry and everything below it are unexplained
+	size_t count;
+	uintmax_t size;
+	size_t index;      // in cruft4, or SIZE_MAX
+};
+
+bool is_below(const string& path, const string& dir)
+{
+	return path.size() > dir.size()
+	    && path[dir.size()] == '/'
+	    && path.compare(0, dir.size(), dir) == 0;
+}
+
+/* In plain sorted order "/a-b" and "/a.c" come between "/a" and "/a/x",
+   so a directory stays open until the first path that sorts after
+   all its descendants, i.e. does not start with "/a" followed by
+   a character up to '/'. */
+bool is_past(const string& path, const string& dir)
+{
+	if (path.compare(0, dir.size(), dir) != 0)
+		return true;
+	return path.size() > dir.size() && path[dir.size()] > '/';
+}
+
+}
+
+void collapse(const vector<string>& fs, const vector<string>& dpkg,
+              const vector<string>& cruft4, const string& root_dir,
+              vector<collapsed>& out)
+{
+	struct result { size_t count = 0; uintmax_t size = 0; };
+	vector<result> results(cruft4.size());
+	vector<frame> stack;
+
+	auto close = [&]() {
+		frame f = stack.back();
+		stack.pop_back();
+		if (f.all && f.count > 0)
+			results[f.index] = { f.count, f.size };
+		// the parent directory may not be the frame right below
+		for (auto parent = stack.rbegin(); parent != stack.rend(); parent++) {
+			if (is_below(*f.path, *parent->path)) {
+				parent->all = parent->all && f.all;
+				parent->count += 1 + f.count;
+				parent->size += f.size;
+				break;
+			}
+		}
+	};
+
+	// one pass over fs ∪ dpkg, both sorted
+	size_t c = 0;
+	auto left = fs.begin();
+	auto right = dpkg.begin();
+	while (left != fs.end() || right != dpkg.end()) {
+		const string* path;
+		if (right == dpkg.end() || (left != fs.end() && *left < *right)) {
+			path = &*left++;
+		} else if (left == fs.end() || *right < *left) {
+			path = &*right++;
+		} else {
+			path = &*left++;
+			right++;
+		}
+
+		while (!stack.empty() && is_past(*path, *stack.back().path))
+			close();
+
+		frame f { path, false, 0, 0, SIZE_MAX };
+		if (c < cruft4.size() && cruft4[c] == *path) {
+			f.all = true;
+			f.index = c++;
+			struct stat st;
+			string real = root_dir + path->substr(1);
+			if (counted_lstat(real.c_str(), &st) == 0 && !S_ISDIR(st.st_mode))
+				f.size = st.st_size;
+		}
+		stack.push_back(f);
+	}
+	while (!stack.empty())
+		close();
+
+	// only print the outermost collapsed directory
+	unordered_set<string> folded;
+	for (size_t i = 0; i < cruft4.size(); i++) {
+		const auto& path = cruft4[i];
+		bool hidden = false;
+		for (auto slash = path.rfind('/'); slash != 0 && slash != string::npos; slash = path.rfind('/', slash - 1)) {
+			if (folded.count(path.substr(0, slash))) {
+				hidden = true;
+				break;
+			}
+		}
+		if (hidden) continue;
+		if (results[i].count > 0)
+			folded.insert(path);
+		out.push_back({ path, results[i].count, results[i].size });
+	}
+}
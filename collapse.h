@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct collapsed
+{
+	std::string path;
+	size_t count = 0;      // number of entries below 'path', 0 if not collapsed
+	uintmax_t size = 0;    // bytes of the files below 'path'
+};
+
+/* folds each directory that is unexplained, together with everything below it,
+   and holds no dpkg-owned file into one entry;
+   all three lists are sorted and 'cruft4' is a subset of 'fs' */
+void collapse(const std::vector<std::string>& fs, const std::vector<std::string>& dpkg,
+              const std::vector<std::string>& cruft4, const std::string& root_dir,
+              std::vector<collapsed>& out);
@@ -0,0 +1,309 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columns.h"
+
+using namespace std;
+
+static const char magic[8] = {'C', 'R', 'U', 'F', 'T', 'C', 'O', 'L'};
+static const uint32_t byte_order = 0x01020304;
+static const uint32_t version = 2;
+static const uint64_t block = 64;
+
+const char* verdict_name(uint8_t v)
+{
+	switch (v) {
+	case verdict_static: return "static";
+	case verdict_explained: return "explained";
+	case verdict_unexplained: return "unexplained";
+	case verdict_missing: return "missing";
+	}
+	return "?";
+}
+
+static void put_varint(string& out, uint64_t value)
+{
+	while (value >= 0x80) {
+		out += char(value | 0x80);
+		value >>= 7;
+	}
+	out += char(value);
+}
+
+static void align(string& out)
+{
+	out.resize((out.size() + 7) & ~size_t(7), '\0');
+}
+
+static void put(string& out, uint64_t value, unsigned width)
+{
+	for (unsigned i = 0; i < width; i++)
+		out += char(value >> (8 * i));
+}
+
+static uint64_t get(const char* pos, unsigned width)
+{
+	uint64_t value = 0;
+	for (unsigned i = 0; i < width; i++)
+		value |= uint64_t(static_cast<unsigned char>(pos[i])) << (8 * i);
+	return value;
+}
+
+static unsigned width_of(uint64_t max)
+{
+	return max < 1ull << 8 ? 1 : max < 1ull << 16 ? 2 : max < 1ull << 32 ? 4 : 8;
+}
+
+void column_writer::add(string path, const string& package, char type, uint8_t verdict, uint64_t size)
+{
+	auto found = index.find(package);
+	uint32_t id;
+	if (found == index.end()) {
+		id = dictionary.size();
+		dictionary.push_back(package);
+		index.emplace(package, id);
+	} else {
+		id = found->second;
+	}
+	rows.push_back({std::move(path), id, type, verdict, size});
+}
+
+bool column_writer::write(const string& file)
+{
+	// a path shipped by several packages is kept once, from the first one
+	stable_sort(rows.begin(), rows.end(), [](const row& a, const row& b) { return a.path < b.path; });
+	rows.erase(unique(rows.begin(), rows.end(), [](const row& a, const row& b) { return a.path == b.path; }), rows.end());
+
+	column_header h{};
+	memcpy(h.magic, magic, sizeof(magic));
+	h.byte_order = byte_order;
+	h.version = version;
+	h.flags = flags;
+	h.rows = rows.size();
+	h.packages = dictionary.size();
+	h.block = block;
+	h.package_width = width_of(dictionary.size() - 1);
+	uint64_t max_size = 0;
+	for (const auto& r: rows)
+		max_size = max(max_size, r.size);
+	h.size_width = width_of(max_size);
+
+	string out(sizeof(h), '\0');
+
+	h.dictionary = out.size();
+	for (const auto& name: dictionary) {
+		put_varint(out, name.size());
+		out += name;
+	}
+	align(out);
+
+	h.paths = out.size();
+	vector<uint64_t> blocks;
+	const string* last = nullptr;
+	for (size_t i = 0; i < rows.size(); i++) {
+		const string& path = rows[i].path;
+		size_t shared = 0;
+		if (i % block == 0) {
+			blocks.push_back(out.size() - h.paths);
+		} else {
+			size_t max = min(path.size(), last->size());
+			while (shared < max && path[shared] == (*last)[shared])
+				shared++;
+		}
+		put_varint(out, shared);
+		put_varint(out, path.size() - shared);
+		out.append(path, shared, string::npos);
+		last = &path;
+	}
+	align(out);
+
+	h.blocks = out.size();
+	for (auto offset: blocks)
+		put(out, offset, 8);
+
+	h.package_column = out.size();
+	for (const auto& r: rows)
+		put(out, r.package, h.package_width);
+	align(out);
+
+	h.type_column = out.size();
+	for (const auto& r: rows)
+		out += r.type;
+	align(out);
+
+	h.verdict_column = out.size();
+	for (const auto& r: rows)
+		out += char(r.verdict);
+	align(out);
+
+	h.size_column = out.size();
+	for (const auto& r: rows)
+		put(out, r.size, h.size_width);
+	h.end = out.size();
+
+	memcpy(&out[0], &h, sizeof(h));
+
+	// written next to the target, then renamed over it
+	string tmp = file + ".tmp";
+	ofstream f(tmp, ios::binary | ios::trunc);
+	f.write(out.data(), out.size());
+	f.close();
+	if (!f || rename(tmp.c_str(), file.c_str()) != 0) {
+		cerr << "cannot write " << file << ": " << strerror(errno) << '\n';
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+column_reader::~column_reader()
+{
+	if (base)
+		munmap(const_cast<char*>(base), length);
+}
+
+static bool get_varint(const char*& pos, const char* end, uint64_t& value)
+{
+	value = 0;
+	for (int shift = 0; pos < end && shift < 64; shift += 7) {
+		unsigned char c = *pos++;
+		value |= uint64_t(c & 0x7f) << shift;
+		if (!(c & 0x80))
+			return true;
+	}
+	return false;
+}
+
+static bool valid_width(uint32_t width)
+{
+	return width == 1 || width == 2 || width == 4 || width == 8;
+}
+
+bool column_reader::open(const string& file)
+{
+	int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		cerr << "cannot open " << file << ": " << strerror(errno) << '\n';
+		if (fd >= 0) close(fd);
+		return false;
+	}
+	length = st.st_size;
+	void* map = length >= sizeof(column_header) ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (map == MAP_FAILED) {
+		cerr << file << ": not a cruft export\n";
+		length = 0;
+		return false;
+	}
+	base = static_cast<const char*>(map);
+
+	const column_header* h = reinterpret_cast<const column_header*>(base);
+	bool ok = memcmp(h->magic, magic, sizeof(magic)) == 0 && h->byte_order == byte_order
+	       && h->version == version && h->block > 0 && h->end == length
+	       && h->dictionary <= h->paths && h->paths <= h->blocks
+	       && h->blocks + (h->rows + h->block - 1) / h->block * 8 <= h->package_column
+	       && valid_width(h->package_width) && valid_width(h->size_width)
+	       && h->package_column + h->rows * h->package_width <= h->type_column
+	       && h->type_column + h->rows <= h->verdict_column
+	       && h->verdict_column + h->rows <= h->size_column
+	       && h->size_column + h->rows * h->size_width == h->end
+	       && (h->blocks | h->package_column | h->size_column) % 8 == 0;
+
+	const char* pos = base + h->dictionary;
+	const char* end = base + h->paths;
+	for (uint64_t i = 0; ok && i < h->packages; i++) {
+		uint64_t size;
+		ok = get_varint(pos, end, size) && size <= uint64_t(end - pos);
+		if (ok) {
+			dictionary.emplace_back(pos, size);
+			pos += size;
+		}
+	}
+	if (!ok) {
+		cerr << file << ": not a cruft export, or not from this kind of machine\n";
+		dictionary.clear();
+		return false;
+	}
+	header = h;
+	cursor = 0;
+	cursor_pos = base + header->paths;
+	return true;
+}
+
+// decode the path at 'pos' on top of the previous one in 'path'
+static bool decode_path(const char*& pos, const char* end, string& path)
+{
+	uint64_t shared, rest;
+	if (!get_varint(pos, end, shared) || !get_varint(pos, end, rest)
+	    || shared > path.size() || rest > uint64_t(end - pos))
+		return false;
+	path.resize(shared);
+	path.append(pos, rest);
+	pos += rest;
+	return true;
+}
+
+string column_reader::path(uint64_t row) const
+{
+	string path;
+	if (row >= rows())
+		return path;
+	uint64_t offset = get(base + header->blocks + row / header->block * 8, 8);
+	if (offset >= header->blocks - header->paths)
+		return path;
+	const char* pos = base + header->paths + offset;
+	const char* end = base + header->blocks;
+	for (uint64_t i = row - row % header->block; i <= row; i++)
+		if (pos >= end || !decode_path(pos, end, path))
+			return string();
+	return path;
+}
+
+string_view column_reader::package(uint64_t row) const
+{
+	uint64_t id = get(base + header->package_column + row * header->package_width, header->package_width);
+	return id < dictionary.size() ? dictionary[id] : string_view();
+}
+
+char column_reader::type(uint64_t row) const
+{
+	return base[header->type_column + row];
+}
+
+uint8_t column_reader::verdict(uint64_t row) const
+{
+	return base[header->verdict_column + row];
+}
+
+uint64_t column_reader::size(uint64_t row) const
+{
+	return get(base + header->size_column + row * header->size_width, header->size_width);
+}
+
+bool column_reader::next(column_row& out)
+{
+	if (cursor >= rows())
+		return false;
+	if (cursor % header->block == 0)
+		cursor_path.clear();
+	if (!decode_path(cursor_pos, base + header->blocks, cursor_path))
+		return false;
+	out.path = cursor_path;
+	out.package = string(package(cursor));
+	out.type = type(cursor);
+	out.verdict = verdict(cursor);
+	out.size = size(cursor);
+	cursor++;
+	return true;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compat.h"
+
+/* compact binary export of classified paths, one column per field:
+
+     header
+     package dictionary    varint length + name, index 0 is "no package"
+     paths                 front-coded, restarting every 'block' rows
+     block offsets         uint64, one per block, relative to paths
+     package column        dictionary index per row
+     type column           one char per row: f l d ?
+     verdict column        one byte per row, see enum verdict
+     size column           size in bytes per row
+
+   rows are sorted by path, every section starts 8-byte aligned
+   and the whole file is meant to be used through a single mmap();
+   the package and size columns use the smallest of 1, 2, 4 or 8 bytes
+   little-endian integers that fits their largest value, the header
+   is in host byte order and 'byte_order' rejects foreign files */
+
+enum verdict : uint8_t
+{
+	verdict_static = 0,      // shipped by a package
+	verdict_explained = 1,   // matched by the ruleset or an explain script
+	verdict_unexplained = 2,
+	verdict_missing = 3,
+};
+
+// header flags
+enum : uint32_t
+{
+	column_as_root = 1,      // missing files are only checked as root
+};
+
+const char* verdict_name(uint8_t v);
+
+struct column_header
+{
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t version;
+	uint64_t rows;
+	uint64_t packages;
+	uint64_t block;
+	uint32_t package_width;
+	uint32_t size_width;
+	uint32_t flags;
+	uint32_t reserved;
+	uint64_t dictionary;
+	uint64_t paths;
+	uint64_t blocks;
+	uint64_t package_column;
+	uint64_t type_column;
+	uint64_t verdict_column;
+	uint64_t size_column;
+	uint64_t end;
+};
+
+struct column_row
+{
+	std::string path;
+	std::string package;
+	char type;
+	uint8_t verdict;
+	uint64_t size;
+};
+
+class column_writer
+{
+public:
+	void add(std::string path, const std::string& package, char type, uint8_t verdict, uint64_t size);
+	void set_flags(uint32_t value) { flags = value; }
+	// sorts the rows by path, drops duplicate paths; false if the file cannot be written
+	bool write(const std::string& file);
+	size_t size() const { return rows.size(); }
+
+private:
+	struct row
+	{
+		std::string path;
+		uint32_t package;
+		char type;
+		uint8_t verdict;
+		uint64_t size;
+	};
+	std::vector<row> rows;
+	uint32_t flags = 0;
+	std::vector<std::string> dictionary{""};
+	std::unordered_map<std::string, uint32_t> index{{"", 0}};
+};
+
+class column_reader
+{
+public:
+	column_reader() = default;
+	~column_reader();
+	column_reader(const column_reader&) = delete;
+	column_reader& operator=(const column_reader&) = delete;
+
+	// false, with a message on stderr, if 'file' is not a valid export
+	bool open(const std::string& file);
+	uint64_t rows() const { return header ? header->rows : 0; }
+	uint32_t flags() const { return header ? header->flags : 0; }
+	const std::vector<std::string_view>& packages() const { return dictionary; }
+
+	// random access decodes from the start of the row's block,
+	// next() is the cheap way to go over all rows in order
+	std::string path(uint64_t row) const;
+	std::string_view package(uint64_t row) const;
+	char type(uint64_t row) const;
+	uint8_t verdict(uint64_t row) const;
+	uint64_t size(uint64_t row) const;
+	bool next(column_row& out);
+
+private:
+	const char* base = nullptr;
+	size_t length = 0;
+	const column_header* header = nullptr;
+	std::vector<std::string_view> dictionary;
+	uint64_t cursor = 0;
+	const char* cursor_pos = nullptr;
+	std::string cursor_path;
+};
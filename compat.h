@@ -0,0 +1,10 @@
+#pragma once
+
+/* the buster, focal and xenial packages are built as C++14 (BUSTER),
+   where string_view is still in std::experimental */
+#ifdef BUSTER
+#include <experimental/string_view>
+namespace std { using std::experimental::string_view; }
+#else
+#include <string_view>
+#endif
@@ -0,0 +1,69 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <mutex>
+#include <set>
+
+#include "counters.h"
+
+using namespace std;
+
+thread_local op_slot thread_ops_slot;
+
+static const char* const names[op_counters] = {
+	"stat", "statfs", "opendir", "exec", "pipe_bytes", "file_bytes", "glob_calls", "glob_steps", "paths",
+};
+
+// the running threads, and what the finished ones counted
+struct op_registry
+{
+	mutex lock;
+	set<op_slot*> slots;
+	uint64_t finished[op_counters] = {};
+};
+
+static op_registry& registry()
+{
+	static op_registry r;
+	return r;
+}
+
+op_slot::op_slot()
+{
+	for (auto& op: ops)
+		op.store(0, memory_order_relaxed);
+	auto& r = registry();
+	lock_guard<mutex> lock(r.lock);
+	r.slots.insert(this);
+}
+
+op_slot::~op_slot()
+{
+	auto& r = registry();
+	lock_guard<mutex> lock(r.lock);
+	for (int i = 0; i < op_counters; i++)
+		r.finished[i] += ops[i].load(memory_order_relaxed);
+	r.slots.erase(this);
+}
+
+void thread_ops(uint64_t ops[op_counters])
+{
+	for (int i = 0; i < op_counters; i++)
+		ops[i] = thread_ops_slot.ops[i].load(memory_order_relaxed);
+}
+
+void total_ops(uint64_t ops[op_counters])
+{
+	auto& r = registry();
+	lock_guard<mutex> lock(r.lock);
+	for (int i = 0; i < op_counters; i++) {
+		ops[i] = r.finished[i];
+		for (const auto* slot: r.slots)
+			ops[i] += slot->ops[i].load(memory_order_relaxed);
+	}
+}
+
+const char* op_name(int op)
+{
+	return names[op];
+}
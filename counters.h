@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+
+/* what the work of a run consists of, so that a slow host shows
+   different counts, not only a different time: each thread adds to
+   its own counters without locking, they are summed when asked */
+enum op_counter
+{
+	op_stat,          // stat() and lstat()
+	op_statfs,
+	op_opendir,       // directories listed
+	op_exec,          // commands and scripts run
+	op_pipe_bytes,    // read from them
+	op_file_bytes,    // read from files by cruft itself, not by libdpkg
+	op_glob_calls,    // myglob()
+	op_glob_steps,    // characters and wildcards myglob() went through
+	op_paths,         // seen by the scan, ignored or not
+	op_counters
+};
+
+struct op_slot
+{
+	std::atomic<uint64_t> ops[op_counters];
+	op_slot();
+	~op_slot();
+};
+extern thread_local op_slot thread_ops_slot;
+
+inline void count_op(op_counter op, uint64_t n = 1)
+{
+	// only this thread writes, others only read
+	auto& value = thread_ops_slot.ops[op];
+	value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// the counters of this thread since it started
+void thread_ops(uint64_t ops[op_counters]);
+// the sum over all threads, finished or running
+void total_ops(uint64_t ops[op_counters]);
+const char* op_name(int op);
+
+// stat(), lstat() and statfs(), counted
+inline int counted_stat(const char* path, struct stat* buf)
+{
+	count_op(op_stat);
+	return stat(path, buf);
+}
+
+inline int counted_lstat(const char* path, struct stat* buf)
+{
+	count_op(op_stat);
+	return lstat(path, buf);
+}
+
+inline int counted_statfs(const char* path, struct statfs* buf)
+{
+	count_op(op_statfs);
+	return statfs(path, buf);
+}
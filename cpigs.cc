@@ -8,12 +8,11 @@
 
 #include <string.h>
 #include <time.h>
+#include <sys/stat.h>
 
-#include "explain.h"
-#include "filters.h"
-#include "locate.h"
-#include "dpkg.h"
-#include "shellexp.h"
+#include "columns.h"
+#include "libcruft.h"
+#include "trace.h"
 
 using namespace std;
 
@@ -26,24 +25,15 @@ using namespace std::experimental;
 namespace fs = std::experimental::filesystem;
 #endif
 
-clock_t beg = clock();
-
-void elapsed(string action)
-{
-	if (getenv("ELAPSED") == NULL) return;
-	clock_t end = clock();
-	double elapsed_seconds = (end - beg) * 1000 / CLOCKS_PER_SEC;
-	cerr << "elapsed " << action << ": " << elapsed_seconds << endl;
-	beg = end;
-}
-
 int usage()
 {
-	cerr << "usage: " << endl;
-	cerr << "  cpigs [-n] [NUMBER]  : default format" << endl;
-	cerr << "  cpigs -e             : export in ncdu format" << endl;
-	cerr << "  cpigs -c             : export in .csv format" << endl;
-	cerr << "  cpigs -C             : export in .csv format, also static files" << endl;
+	cerr << "usage: " << '\n';
+	cerr << "  cpigs [-n] [NUMBER]  : default format" << '\n';
+	cerr << "  cpigs -e             : export in ncdu format" << '\n';
+	cerr << "  cpigs -c             : export in .csv format" << '\n';
+	cerr << "  cpigs -C             : export in .csv format, also static files" << '\n';
+	cerr << "  cpigs -b FILE        : export in binary format, see cruft-dump" << '\n';
+	cerr << "  cpigs -B FILE        : export in binary format, also static files" << '\n';
 	return 1;
 }
 
@@ -56,7 +46,7 @@ static void output_pigs(long unsigned int limit, const map<string, size_t>& usag
 		return left.second < right.second;
 	});
 	for (size_t i = 0; i < pigs.size() && i < limit; ++i) {
-		if (pigs[i].second > 0) cout << pigs[i].second << " " << pigs[i].first << endl;
+		if (pigs[i].second > 0) cout << pigs[i].second << " " << pigs[i].first << '\n';
 	}
 }
 
@@ -134,7 +124,17 @@ void output_ncdu(vector<string>& cruft_db)
 	}
 
 	for(auto& part : last_dir) { cout << ']'; }
-	cout << "]" << endl;
+	cout << "]" << '\n';
+}
+
+static void export_static(column_writer& exported, const string& path, const char *package)
+{
+	struct stat st;
+	if (lstat(path.c_str(), &st) != 0)
+		return;
+	if (S_ISDIR(st.st_mode))
+		return;
+	exported.add(path, package, S_ISLNK(st.st_mode) ? 'l' : 'f', verdict_static, st.st_size);
 }
 
 int main(int argc, char *argv[])
@@ -142,7 +142,11 @@ int main(int argc, char *argv[])
 	long unsigned int limit = 10;
 
 	bool ncdu = false, csv = false, static_ = false;
-	if (argc == 2 && !strcmp(argv[1], "-e")) {
+	string binary;
+	if (argc == 3 && (!strcmp(argv[1], "-b") || !strcmp(argv[1], "-B"))) {
+		binary = argv[2];
+		static_ = argv[1][1] == 'B';
+	} else if (argc == 2 && !strcmp(argv[1], "-e")) {
 		ncdu = true;
 	} else if (argc == 2 && !strcmp(argv[1], "-c")) {
 		csv = true;
@@ -159,65 +163,47 @@ int main(int argc, char *argv[])
 		} catch(...) { return usage(); }
 	}
 
-	vector<string> fs;
-	read_locate(fs, "/usr/share/cruft/ignore", "/");
-	elapsed("plocate");
+	// ELAPSED or CRUFT_TRACE=FILE
+	trace_start("");
+
+	cruft_config config;
+	config.ignore_file = "/usr/share/cruft/ignore";
+	config.dpkg_csv = csv && static_;
+	cruft_engine engine(config);
 
-	if (csv) cout << "path;package;type;cruft;size" << endl;
+	engine.scan();
+	trace_step("plocate");
 
-	vector<string> packages;
-	vector<string> dpkg;
-	dpkg_start("/");
-	read_dpkg(packages, dpkg, static_, "/");
-	dpkg_end();
-	elapsed("dpkg");
+	if (csv) cout << "path;package;type;cruft;size" << '\n';
+
+	column_writer exported;
+	if (!binary.empty() && static_)
+		engine.load_dpkg([&exported](const string& path, const char *package) {
+			export_static(exported, path, package);
+		});
+	else
+		engine.load_dpkg();
+	trace_step("dpkg");
 
 	vector<string> cruft_db;
-	vector<string>::iterator left=fs.begin();
-	vector<string>::iterator right=dpkg.begin();
-	while (left != fs.end() )
-	{
-		if (*left==*right) {
-			left++;
-			right++;
-		} else if (*left < *right) {
-			cruft_db.push_back(*left);
-			left++;
-		} else {
-			right++;
-		}
-		if (right == dpkg.end())
-                     while(left !=fs.end()) {cruft_db.push_back(*left); left++;};
-	}
-	elapsed("main set match");
+	engine.extra(cruft_db);
+	trace_step("main set match");
+	trace_paths(cruft_db.size());
 
 	if (ncdu) {
 		output_ncdu(cruft_db);
-		return 0;
+		return trace_end() ? 0 : 1;
 	};
 
-	vector<owner> globs;
-	read_filters("/etc/cruft/filters/", "/usr/share/cruft/ruleset", packages, globs);
-	setenv("CRUFT_ROOT", "", 0);
-	read_explain("/etc/cruft/explain/", packages, globs);
-	elapsed("read filters");
+	engine.load_rules();
+	trace_step("read filters");
 
 	std::map<std::string, size_t> usage{{"UNKNOWN", 0}};
 
-	vector<string>::iterator cruft=cruft_db.begin();
-	vector<owner>::iterator owners;
-	while (cruft != cruft_db.end()) {
-		owners = globs.begin();
-		string package = "UNKNOWN";
-		while (owners != globs.end()) {
-			bool match;
-			match = myglob(*cruft,(*owners).path);
-			if (match) {
-				package = (*owners).package;
-                        	break;
-                	}
-			owners++;
-		}
+	for (auto cruft = cruft_db.begin(); cruft != cruft_db.end(); cruft++) {
+		string package;
+		if (engine.owner(*cruft, package) != cruft_explained)
+			package = "UNKNOWN";
 
 		char type;
 		size_t fsize;
@@ -240,17 +226,24 @@ int main(int argc, char *argv[])
 		}
 
 		if (csv) {
-			cout << *cruft << ';' << package << ';' << type << ";1;" << fsize << endl;
+			cout << *cruft << ';' << package << ';' << type << ";1;" << fsize << '\n';
+		} else if (!binary.empty()) {
+			bool unknown = package == "UNKNOWN";
+			exported.add(*cruft, unknown ? "" : package, type,
+			             unknown ? verdict_unexplained : verdict_explained, fsize);
 		} else {
 			if (usage.count(package) == 0) usage[package] = 0;
 			usage[package] += fsize;
 		}
+	}
+	trace_step("extra vs globs");
 
-		cruft++;
+	if (!binary.empty()) {
+		bool written = exported.write(binary);
+		return trace_end() && written ? 0 : 1;
 	}
-	elapsed("extra vs globs");
 
 	output_pigs(limit, usage);
 
-	return 0;
+	return trace_end() ? 0 : 1;
 }
@@ -1,10 +1,17 @@
 #!/bin/sh
-[ -e "/home/$USER/cruft-ng.log" ] && mv "/home/$USER/cruft-ng.log" "/home/$USER/cruft-ng.log.old"
+# the full report goes to ~/cruft-ng.log, compared with the previous one,
+# then what changed since the previous run according to the snapshot
+log="/home/$USER/cruft-ng.log"
+snapshot=/var/lib/cruft/cruft-ng.snapshot
 if [ -x cruft-ng ]
 then
-	sudo ./cruft-ng > "/home/$USER/cruft-ng.log"
+	cruft=./cruft-ng
 else
-	sudo cruft-ng > "/home/$USER/cruft-ng.log"
+	cruft=cruft-ng
 fi
-ls -l /home/$USER/cruft-ng.log*
-[ -e "/home/$USER/cruft-ng.log.old" ] && colordiff -u "/home/$USER/cruft-ng.log.old" "/home/$USER/cruft-ng.log"
+[ -e "$log" ] && mv "$log" "$log.old"
+sudo $cruft > "$log"
+ls -l "$log"*
+[ -e "$log.old" ] && colordiff -u "$log.old" "$log"
+sudo mkdir -p "$(dirname "$snapshot")"
+sudo $cruft --delta "$snapshot"
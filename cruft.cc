@@ -4,8 +4,14 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
-#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
 #include <thread>
+#include <ctime>
 
 #include <sys/stat.h>
 #include <getopt.h>
@@ -13,13 +19,23 @@
 #include <unistd.h>
 #include <dirent.h>
 
+#include "counters.h"
 #include "explain.h"
 #include "filters.h"
 #include "locate.h"
 #include "dpkg.h"
 #include "dpkg_exclude.h"
+#include "estimate.h"
 #include "shellexp.h"
 #include "bugs.h"
+#include "bundle.h"
+#include "read_ignores.h"
+#include "scheduler.h"
+#include "trace.h"
+#include "match.h"
+#include "memo.h"
+#include "progress.h"
+#include "report.h"
 
 using namespace std;
 
@@ -28,47 +44,13 @@ using namespace std;
 #define UPDATEDB "updatedb.mlocate"
 #else
 #include "nolocate.h"
+#include "stream.h"
+#include "extsort.h"
+#include "mounts.h"
 #define LOCATE_DB "/var/lib/plocate/plocate.db"
 #define UPDATEDB "updatedb.plocate"
 #endif
 
-/*
-static int read_mounts(const vector<string>& prunefs, vector<string>& mounts)
-{
-	// this doesn't include "/", as it always exists
-	ifstream mtab("/proc/mounts");
-	string mount,type;
-	while (mtab.good())
-	{
-		getline(mtab,mount,' '); // discard device
-		getline(mtab,mount,' ');
-		getline(mtab,type,' ');
-
-		bool match=false;
-		if (mount=="/") match=true;
-		else if (mount.rfind("/sys/", 0) == 0) match=true;
-		else if (mount.rfind("/dev/", 0) == 0) match=true;
-		else {
-			for (const auto& elem: prunefs) {
-				string uppercase=type;
-				transform(uppercase.begin(), uppercase.end(), uppercase.begin(), ::toupper);
-				if (uppercase==elem) {
-			  		match=true;
-					break;
-		      	}
-	      	}
-		}
-
-		if (!match) {
-			//cerr << mount << " => " << type << endl;
-			mounts.emplace_back(mount);
-		}
-		getline(mtab,mount); // discard options
-	}
-	return 0;
-}
-*/
-
 static bool updatedb()
 {
 	/* return value is meant as an are_we_up_to_date flag
@@ -164,16 +146,7 @@ static int one_package(const string& package)
 	return 0;
 }
 
-static clock_t beg = clock();
-
-static void elapsed(const string& action)
-{
-	if (getenv("ELAPSED") == nullptr) return;
-	clock_t end = clock();
-	clock_t elapsed_mseconds = (end - beg) * 1000 / CLOCKS_PER_SEC;
-	cerr << "elapsed " << action << ": " << elapsed_mseconds << '\n';
-	beg = end;
-}
+static const auto started = chrono::steady_clock::now();
 
 static const char* const default_explain_dir = "/etc/cruft/explain/";
 static const char* const default_filter_dir = "/etc/cruft/filters/";
@@ -181,6 +154,11 @@ static const char* const default_ignore_file = "/etc/cruft/ignore";
 static const char* const default_ruleset_file = "/usr/share/cruft/ruleset";
 static const char* const default_bugs_file = "/usr/share/cruft/bugs";
 static const char* const default_root_dir = "/";
+// the counts of the previous run, for the ETA of --progress
+static const char* const progress_file = "/var/cache/cruft/progress";
+
+// the smallest --max-memory, in MiB
+static const size_t max_memory_min = 8;
 
 static void print_help_message()
 {
@@ -198,6 +176,24 @@ static void print_help_message()
 #ifndef BUSTER
 	cout << "    -n --no-locate   do not use locate\n";
 	cout << "    -r --root        root directory (default: " << default_root_dir << ", only works with --no-locate)\n";
+	cout << "    -s --stream      report each top-level directory as soon as it is scanned\n";
+	cout << "    -m --max-memory  sort the file lists on disk, using at most this many MiB (at least " << max_memory_min << ")\n";
+	cout << "    -f --split-fs    one report section per mounted filesystem\n";
+	cout << "    -c --collapse    print fully unexplained directories once, not their content\n";
+	cout << "    -o --format      report format: text, json or ndjson (default: text)\n";
+	cout << "    -x --export      also write the report to this file in binary form, see cruft-dump\n";
+	cout << "    -d --delta       only report what changed since the previous run with this snapshot file\n";
+	cout << "    -k --cache       reuse the rule matches of unchanged directories kept in this file;\n";
+	cout << "                     the scan, dpkg and explain scripts still run (default mode only)\n";
+	cout << "    -t --deadline    report what is classified after this many seconds, and what is not\n";
+	cout << "       --estimate    estimate the unexplained files and bytes from this many random walks\n";
+	cout << "                     down the directories, instead of a full scan (implies --no-locate)\n";
+	cout << "       --record      save everything read from the system to this bundle\n";
+	cout << "       --replay      run again from a bundle saved by --record, without looking at the system\n";
+	cout << "       --trace       write the cost of each phase to this file, as Chrome trace events\n";
+	cout << "       --metrics     also write the figures of the run to this file, for the Prometheus textfile collector\n";
+	cout << "       --progress    show the phase, the rates and an ETA on stderr every second\n";
+	cout << "                     (without it: once on SIGUSR1)\n";
 #endif
 
 	cout << '\n';
@@ -205,180 +201,908 @@ static void print_help_message()
 	cout << "    -h --help        this help message\n";
 }
 
-static void cruft(const string& ignore_file,
-                  const string& filter_dir,
-                  const string& ruleset_file,
-                  const string& explain_dir,
-                  const string& bugs_file,
-                  bool locate,
-                  const string& root_dir)
+struct options
 {
-	bool debug = getenv("DEBUG") != nullptr;
+	string ignore_file = default_ignore_file;
+	string filter_dir = default_filter_dir;
+	string ruleset_file = default_ruleset_file;
+	string explain_dir = default_explain_dir;
+	string bugs_file = default_bugs_file;
+	string root_dir = default_root_dir;
+	bool locate = true;
+	bool stream = false;
+	bool split_fs = false;
+	bool collapse = false;
+	size_t max_memory = 0;
+	report_format format = report_format::text;
+	string export_file;
+	string delta_file;
+	string cache_file;
+	long deadline = 0;
+	size_t estimate = 0;
+	string record_file;
+	string replay_file;
+	string trace_file;
+	string metrics_file;
+	bool progress = false;
+};
 
-	const int SIZEBUF = 200;
-	char buf[SIZEBUF];
-	time_t rawtime;
-	struct tm * timeinfo;
-	time(&rawtime);
-	timeinfo=localtime(&rawtime);
-	setlocale(LC_TIME, "");
-	strftime(buf, sizeof(buf), "%c", timeinfo);
-	cout << "cruft report: " << buf << '\n';
+// the options without a short form
+enum { option_record = 256, option_replay, option_trace, option_metrics, option_progress, option_estimate };
 
-	if (locate) {
-		bool updated = updatedb();
-		if (!updated) {
-			cerr << "warning: plocate database is outdated" << endl << flush;
-		}
-		elapsed("updatedb");
+// number of top-level directories in flight between two stages of --stream
+static const size_t stream_queue_size = 4;
+
+// paths classified at once in --max-memory mode
+static const size_t low_memory_batch = 4096;
+
+// top-level directories classified first in --deadline mode, the others follow in sorted order
+static const vector<string> deadline_first = {"/etc", "/var"};
+
+// everything the matching phases need besides the scanned files
+struct inputs
+{
+	explicit inputs(const options& opt) : bugs(opt.bugs_file) {}
+
+	vector<string> packages;
+	vector<string> excludes;
+	known_bugs bugs;
+	vector<owner> globs;
+	vector<owner> explain_uppercase;
+	vector<owner> explain;
+	// --replay reads all of the above from it, --record writes them to it
+	bundle saved;
+};
+
+// all these phases only need "dpkg" to fill in.packages
+static void read_inputs(const options& opt, scheduler& phases, inputs& in)
+{
+	// https://bugs.debian.org/cgi-bin/bugreport.cgi?bug=619086
+	phases.add("read excludes", {}, [&] {
+		if (opt.replay_file.empty())
+			read_dpkg_excludes(in.excludes);
+		else
+			in.saved.get("excludes", in.excludes);
+	});
+
+	phases.add("read filters", {"dpkg"}, [&] {
+		if (opt.replay_file.empty())
+			read_filters(opt.filter_dir, opt.ruleset_file, in.packages, in.globs);
+		else
+			in.saved.get("globs", in.globs);
+	});
+
+	// --deadline runs the explain scripts one by one itself
+	if (opt.deadline)
+		return;
+
+	if (!opt.replay_file.empty()) {
+		phases.add("read explain uppercase", {}, [] {});
+		phases.add("read explain", {"dpkg"}, [] {});
+		phases.add("merge explain", {"read explain uppercase", "read explain"}, [&] {
+			in.saved.get("explain", in.explain);
+		});
+		return;
 	}
 
+	// the uppercase "explain" scripts do not depend on installed packages
+	phases.add("read explain uppercase", {}, [&] {
+		read_explain_uppercase(opt.explain_dir, in.explain_uppercase);
+	});
+
+	phases.add("read explain", {"dpkg"}, [&] {
+		read_explain_packages(opt.explain_dir, in.packages, in.explain);
+	});
+
+	phases.add("merge explain", {"read explain uppercase", "read explain"}, [&] {
+		in.explain.insert(in.explain.end(), in.explain_uppercase.begin(), in.explain_uppercase.end());
+		sort(in.explain.begin(), in.explain.end());
+		in.explain.erase( unique( in.explain.begin(), in.explain.end() ), in.explain.end() );
+	});
+}
+
+static void unused_globs(const vector<owner>& globs, const vector<bool>& used_globs)
+{
+	for (size_t i = 0; i < globs.size() && i < used_globs.size(); i++)
+		if (!used_globs[i])
+			cout << "unused ruleset: " << globs[i].package << " " << globs[i].path << endl;
+}
+
+static void cruft_all(const options& opt, scheduler& phases, inputs& in, bool debug)
+{
 	vector<string> fs;
+	vector<string> dpkg;
+	vector<string> cruft;
+	vector<string> missing;
+	vector<string> missing2;
+	vector<string> cruft3;
+	vector<string> cruft4;
+	// the missing files that are there all the same, for --record and --replay
+	vector<string> present;
+	bool replay = !opt.replay_file.empty();
+
+	phases.add("scan", {}, [&] {
+		if (replay) {
+			in.saved.get("scan", fs);
+			return;
+		}
 #ifndef BUSTER
-	thread thr_plocate(locate ? read_locate : read_nolocate, ref(fs), ignore_file, root_dir);
+		(opt.locate ? read_locate : read_nolocate)(fs, opt.ignore_file, opt.root_dir);
 #else
-	thread thr_plocate(read_locate, ref(fs), ignore_file, root_dir);
+		read_locate(fs, opt.ignore_file, opt.root_dir);
 #endif
+	});
 
-	vector<string> packages;
+	phases.add("dpkg", {}, [&] {
+		if (replay) {
+			in.saved.get("packages", in.packages);
+			in.saved.get("dpkg", dpkg);
+			return;
+		}
+		dpkg_start(opt.root_dir);
+		read_dpkg(in.packages, dpkg, false, opt.root_dir);
+		dpkg_end();
+	});
+
+	// match two main data sources
+	phases.add("main set match", {"scan", "dpkg"}, [&] {
+		match_dpkg(fs, dpkg, cruft, missing);
+		if (debug) cerr << missing.size() << " files in missing database\n";
+		if (debug) cerr << cruft.size() << " files in cruft database\n\n";
+	});
+
+	phases.add("missing2", {"main set match", "read excludes"}, [&] {
+		if (replay)
+			in.saved.get("present", present);
+		match_missing(missing, in.excludes, missing2, debug, [&](const string& path) {
+			if (replay)
+				return binary_search(present.begin(), present.end(), path);
+			struct stat stat_buffer;
+			bool exists = counted_stat(path.c_str(), &stat_buffer) == 0;
+			if (exists) present.push_back(path);
+			return exists;
+		});
+	});
+
+	// match the globs against reduced database
+	phases.add("extra vs globs", {"main set match", "read filters"}, [&] {
+		vector<bool> used_globs;
+		bool all_matched = true;
+		if (opt.cache_file.empty()) {
+			match_globs(cruft, in.globs, used_globs, cruft3);
+		} else {
+			verdict_cache cache(opt.cache_file, in.globs);
+			cache.match_globs(cruft, in.globs, used_globs, cruft3);
+			cache.save();
+			all_matched = cache.hits == 0;
+			if (debug) cerr << cache.hits << " directories from cache, " << cache.misses << " matched again\n";
+		}
+		// the globs used by cached directories are not known
+		if (debug && all_matched) unused_globs(in.globs, used_globs);
+		if (debug) cerr << cruft3.size() << " files in cruft3 database\n\n";
+	});
+
+	// match the dynamic "explain" filters
+	phases.add("extra vs explain", {"extra vs globs", "merge explain"}, [&] {
+		match_explain(cruft3, in.explain, cruft4);
+	});
+
+	// timed like the others, to see what the output costs
+	phases.add("report", {"missing2", "extra vs explain"}, [&] {
+		if (debug) cerr << cruft4.size() << " files in cruft4 database\n";
+		report_count("scanned", fs.size());
+		trace_paths(fs.size());
+		report_count("dpkg", dpkg.size());
+		// what is left after each stage
+		report_count("unowned", cruft.size());
+		report_count("unmatched", cruft3.size());
+
+		report_missing(missing2);
+
+		if (opt.collapse) {
+			vector<collapsed> folded;
+			collapse(fs, dpkg, cruft4, opt.root_dir, folded);
+			report_unexplained("/", folded, in.bugs);
+		} else {
+			report_unexplained("/", cruft4, in.bugs);
+		}
+	});
+
+	phases.run();
+
+	if (!opt.record_file.empty()) {
+		in.saved.put("scan", fs);
+		in.saved.put("packages", in.packages);
+		in.saved.put("dpkg", dpkg);
+		in.saved.put("present", present);
+		in.saved.put("excludes", in.excludes);
+		in.saved.put("globs", in.globs);
+		in.saved.put("explain", in.explain);
+	}
+}
+
+#ifndef BUSTER
+/* scan -> dpkg + globs -> explain + report,
+   each top-level directory is reported as soon as it is classified */
+static void cruft_stream(const options& opt, scheduler& phases, inputs& in, bool debug)
+{
+	bounded_queue<shard> scanned(stream_queue_size);
+	bounded_queue<shard> merged(stream_queue_size);
 	vector<string> dpkg;
-	dpkg_start(root_dir);
-	thread thr_dpkg(read_dpkg, ref(packages), ref(dpkg), false, root_dir);
-	thr_plocate.join();
-	thr_dpkg.join();
-	dpkg_end();
-	elapsed("plocate + dpkg");
+	map<string, vector<string>> dpkg_shards;
+	vector<bool> used_globs;
+	vector<string> missing2;
+	size_t scanned_count = 0;
+	size_t dpkg_count = 0;
 
-	map<string, bug> bugs;
-	read_bugs(bugs, bugs_file);
+	phases.add("scan", {}, [&] {
+		shard_builder builder(scanned);
+		(opt.locate ? scan_locate : scan_nolocate)([&](string&& path) { builder.add(std::move(path)); scanned_count++; },
+		                                           opt.ignore_file, opt.root_dir);
+		builder.finish();
+	});
 
-	// match two main data sources
-	vector<string> cruft;
-	vector<string> missing;
-	for (auto left=fs.begin(), right=dpkg.begin(); left != fs.end() && right != dpkg.end();)
+	phases.add("dpkg", {}, [&] {
+		dpkg_start(opt.root_dir);
+		read_dpkg(in.packages, dpkg, false, opt.root_dir);
+		dpkg_end();
+	});
+
+	phases.add("split dpkg", {"dpkg"}, [&] {
+		dpkg_count = dpkg.size();
+		for (auto& path: dpkg)
+			dpkg_shards[shard_of(path)].emplace_back(std::move(path));
+		dpkg.clear();
+	});
+
+	phases.add("extra vs globs", {"split dpkg", "read filters"}, [&] {
+		const vector<string> none;
+		set<string> seen;
+		used_globs.assign(in.globs.size(), false);
+		shard s;
+		while (scanned.pop(s)) {
+			auto dp = dpkg_shards.find(s.name);
+			vector<string> cruft;
+			match_dpkg(s.paths, dp == dpkg_shards.end() ? none : dp->second, cruft, s.missing);
+			s.paths.clear();
+			match_globs(cruft, in.globs, used_globs, s.paths);
+			seen.insert(s.name);
+			merged.push(std::move(s));
+		}
+		// whole top-level directories that are gone
+		for (auto& dp: dpkg_shards) {
+			if (seen.count(dp.first)) continue;
+			s = shard();
+			s.name = dp.first;
+			s.missing = std::move(dp.second);
+			merged.push(std::move(s));
+		}
+		merged.close();
+	});
+
+	phases.add("extra vs explain", {"merge explain", "read excludes"}, [&] {
+		shard s;
+		while (merged.pop(s)) {
+			vector<string> cruft4;
+			match_explain(s.paths, in.explain, cruft4);
+			match_missing(s.missing, in.excludes, missing2, debug);
+			if (!cruft4.empty()) {
+				report_unexplained(s.name, cruft4, in.bugs);
+				report_flush();
+			}
+		}
+	});
+
+	phases.run();
+
+	if (debug) unused_globs(in.globs, used_globs);
+	report_count("scanned", scanned_count);
+	trace_paths(scanned_count);
+	report_count("dpkg", dpkg_count);
+
+	sort(missing2.begin(), missing2.end());
+	report_missing(missing2);
+}
+
+/* one shard per mounted filesystem, scanned (with --no-locate)
+   and classified in parallel; each section is printed when ready */
+static void cruft_split_fs(const options& opt, scheduler& phases, inputs& in, bool debug)
+{
+	vector<mount> mounts;
+	// without the mount table, the whole root is one shard
+	if (read_mounts(mounts, opt.root_dir) != 0)
+		mounts.assign(1, {"/", "", ""});
+
+	struct fs_shard
 	{
-		//cerr << "[" << *left << "=" << *right << "]" << endl;
-		if (*left==*right) {
-			left++;
-			right++;
-		} else if (*left < *right) {
-			cruft.push_back(*left);
-			left++;
-		} else {
-			missing.push_back(*right);
-			right++;
+		vector<string> fs;
+		vector<string> dpkg;
+		vector<string> missing2;
+		vector<bool> used_globs;
+		long scan_ms = -1;
+	};
+	vector<fs_shard> shards(mounts.size());
+	auto index_of = [&mounts](const string& path) { return &mount_of(path, mounts) - &mounts[0]; };
+	auto ms_since = [](chrono::steady_clock::time_point beg) {
+		return long(chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - beg).count());
+	};
+
+	vector<string> fs;
+	vector<string> dpkg;
+	mutex output;
+
+	if (opt.locate) {
+		phases.add("scan", {}, [&] {
+			read_locate(fs, opt.ignore_file, opt.root_dir);
+		});
+		phases.add("split scan", {"scan"}, [&] {
+			for (auto& path: fs)
+				shards[index_of(path)].fs.emplace_back(std::move(path));
+			fs.clear();
+		});
+	} else {
+		vector<string> points;
+		for (const auto& m: mounts)
+			points.push_back(m.point);
+		for (size_t i = 0; i < mounts.size(); i++) {
+			phases.add("scan " + mounts[i].point, {}, [&, i, points] {
+				auto beg = chrono::steady_clock::now();
+				auto& sh = shards[i];
+				scan_nolocate_mount([&sh](string&& path) { sh.fs.emplace_back(std::move(path)); },
+				                    opt.ignore_file, opt.root_dir, mounts[i].point, points);
+				sort(sh.fs.begin(), sh.fs.end());
+				sh.fs.erase( unique( sh.fs.begin(), sh.fs.end() ), sh.fs.end() );
+				sh.scan_ms = ms_since(beg);
+			});
 		}
-		if (right == dpkg.end()) while(left  !=fs.end()  ) {cruft.push_back(*left);    left++; }
-		if (left  == fs.end()  ) while(right !=dpkg.end()) {missing.push_back(*right); right++;}
 	}
-	elapsed("main set match");
 
-	if (debug) cerr << missing.size() << " files in missing database\n";
-	if (debug) cerr << cruft.size() << " files in cruft database\n\n";
+	phases.add("dpkg", {}, [&] {
+		dpkg_start(opt.root_dir);
+		read_dpkg(in.packages, dpkg, false, opt.root_dir);
+		dpkg_end();
+	});
 
-	// https://bugs.debian.org/cgi-bin/bugreport.cgi?bug=619086
-	vector<string> excludes;
-	read_dpkg_excludes(excludes);
-	elapsed("read excludes");
+	phases.add("split dpkg", {"dpkg"}, [&] {
+		for (auto& path: dpkg)
+			shards[index_of(path)].dpkg.emplace_back(std::move(path));
+		dpkg.clear();
+	});
+
+	for (size_t i = 0; i < mounts.size(); i++) {
+		string scan = opt.locate ? "split scan" : "scan " + mounts[i].point;
+		phases.add("classify " + mounts[i].point,
+		           {scan, "split dpkg", "read filters", "merge explain", "read excludes"},
+		           [&, i] {
+			auto beg = chrono::steady_clock::now();
+			auto& sh = shards[i];
+			vector<string> cruft, missing, cruft3, cruft4;
+			match_dpkg(sh.fs, sh.dpkg, cruft, missing);
+			match_missing(missing, in.excludes, sh.missing2, debug);
+			match_globs(cruft, in.globs, sh.used_globs, cruft3);
+			match_explain(cruft3, in.explain, cruft4);
+
+			string section = mounts[i].point + " (";
+			if (!mounts[i].type.empty())
+				section += mounts[i].type + " " + mounts[i].device + ", ";
+			section += to_string(sh.fs.size()) + " files, "
+			         + to_string(cruft4.size()) + " unexplained, ";
+			if (sh.scan_ms >= 0)
+				section += "scan " + to_string(sh.scan_ms) + " ms, ";
+			section += "classify " + to_string(ms_since(beg)) + " ms)";
+
+			vector<collapsed> folded;
+			if (opt.collapse)
+				collapse(sh.fs, sh.dpkg, cruft4, opt.root_dir, folded);
+
+			lock_guard<mutex> lock(output);
+			if (opt.collapse)
+				report_unexplained(section, folded, in.bugs);
+			else
+				report_unexplained(section, cruft4, in.bugs);
+			report_flush();
+		});
+	}
+
+	phases.run();
+
+	if (debug) {
+		vector<bool> used_globs(in.globs.size(), false);
+		for (const auto& sh: shards)
+			for (size_t i = 0; i < sh.used_globs.size(); i++)
+				if (sh.used_globs[i]) used_globs[i] = true;
+		unused_globs(in.globs, used_globs);
+	}
+
+	size_t scanned_count = 0;
+	size_t dpkg_count = 0;
 	vector<string> missing2;
-	unsigned long count_stat = 0;
-	for (const auto& miss: missing) {
-		bool match=false;
-		for (const auto& ex: excludes) {
-			match=myglob(miss,ex);
-			if (match) break;
-		}
-		if (!match) {
-			// file may exist on tmpfs
-			// e.g.: /var/cache/apt/archives/partial
-			struct stat stat_buffer;
-	                if ( stat(miss.c_str(), &stat_buffer) == 0) {
-				count_stat += 1;
-				if (debug) cerr << miss << " was not in plocate database\n";
+	for (auto& sh: shards) {
+		scanned_count += sh.fs.size();
+		dpkg_count += sh.dpkg.size();
+		missing2.insert(missing2.end(), sh.missing2.begin(), sh.missing2.end());
+	}
+	report_count("mounts", mounts.size());
+	report_count("scanned", scanned_count);
+	trace_paths(scanned_count);
+	report_count("dpkg", dpkg_count);
+	sort(missing2.begin(), missing2.end());
+	report_missing(missing2);
+}
+
+/* same as cruft_all(), but the scanned and dpkg files
+   are sorted on disk and classified while being merged */
+static void cruft_low_memory(const options& opt, scheduler& phases, inputs& in, bool debug)
+{
+	// the scan is usually much bigger than the other two
+	external_sorter fs(opt.max_memory / 2);
+	external_sorter dpkg(opt.max_memory / 4);
+	external_sorter cruft4(opt.max_memory / 4);
+	vector<string> missing;
+	vector<string> missing2;
+	vector<bool> used_globs;
+	size_t scanned_count = 0;
+	size_t dpkg_count = 0;
+
+	phases.add("scan", {}, [&] {
+		(opt.locate ? scan_locate : scan_nolocate)([&](string&& path) { fs.add(std::move(path)); scanned_count++; },
+		                                           opt.ignore_file, opt.root_dir);
+		fs.finish();
+		if (debug) cerr << fs.runs() << " sorted runs of scanned files\n";
+	});
+
+	phases.add("dpkg", {}, [&] {
+		dpkg_start(opt.root_dir);
+		scan_dpkg(in.packages, [&](string&& path, const char*) { dpkg.add(std::move(path)); dpkg_count++; }, false, opt.root_dir);
+		dpkg_end();
+		dpkg.finish();
+		if (debug) cerr << dpkg.runs() << " sorted runs of dpkg files\n";
+	});
+
+	phases.add("classify", {"scan", "dpkg", "read filters", "merge explain"}, [&] {
+		vector<string> cruft;
+		auto classify = [&] {
+			vector<string> cruft3;
+			vector<string> unexplained;
+			match_globs(cruft, in.globs, used_globs, cruft3);
+			match_explain(cruft3, in.explain, unexplained);
+			for (auto& cr: unexplained)
+				cruft4.add(std::move(cr));
+			cruft.clear();
+		};
+
+		string left, right;
+		bool has_left = fs.next(left);
+		bool has_right = dpkg.next(right);
+		while (has_left || has_right) {
+			if (has_left && has_right && left == right) {
+				has_left = fs.next(left);
+				has_right = dpkg.next(right);
+			} else if (has_left && (!has_right || left < right)) {
+				cruft.emplace_back(std::move(left));
+				if (cruft.size() == low_memory_batch) classify();
+				has_left = fs.next(left);
 			} else {
-				missing2.push_back(miss);
+				missing.emplace_back(std::move(right));
+				has_right = dpkg.next(right);
 			}
 		}
-	}
-	elapsed("missing2");
-	if (debug) cerr << "count stat():" << count_stat << '\n';
+		classify();
+		cruft4.finish();
+	});
 
-	// match the globs against reduced database
-	vector<owner> globs;
-	read_filters(filter_dir, ruleset_file, packages, globs);
-	elapsed("read filters");
-	vector<string> cruft3;
-	vector<bool> used_globs(globs.size(), false);
-	for (const auto& cr: cruft) {
-		bool match=false;
-		for (size_t i = 0; i < globs.size(); i++) {
-			match=myglob(cr, globs[i].path);
-			if (match) {
-				used_globs[i] = true;
-				break;
+	phases.add("missing2", {"classify", "read excludes"}, [&] {
+		match_missing(missing, in.excludes, missing2, debug);
+	});
+
+	phases.run();
+
+	if (debug) unused_globs(in.globs, used_globs);
+	// both before removing duplicates
+	report_count("scanned", scanned_count);
+	trace_paths(scanned_count);
+	report_count("dpkg", dpkg_count);
+
+	report_missing(missing2);
+	report_unexplained("/", [&cruft4](string& path) { return cruft4.next(path); }, in.bugs);
+}
+
+/* same pipeline as cruft_stream(), but the top-level directories and
+   the explain scripts are taken in priority order; when the deadline
+   comes, what is classified so far is reported together with what is not,
+   and the phases still running are abandoned: this does not return then */
+static void cruft_deadline(const options& opt, scheduler& phases, inputs& in, bool debug)
+{
+	bounded_queue<shard> scanned(stream_queue_size);
+	vector<string> dpkg;
+	map<string, vector<string>> dpkg_shards;
+	vector<bool> used_globs;
+
+	// shared with the main thread, which may report at any time
+	mutex progress;
+	condition_variable finished;
+	bool done = false;
+	vector<shard> classified;    // paths: cruft3, missing: missing2
+	vector<string> pending;      // top-level directories not classified yet
+	vector<owner> scripts;       // explain scripts not run yet
+	vector<owner> explain;       // what the scripts run so far explain
+	atomic<size_t> scanned_count{0}; // as the scan goes, for a report in the middle of it
+	size_t dpkg_count = 0;
+	size_t packages_count = 0;
+	size_t rules_count = 0;
+
+	pending = nolocate_toplevel(opt.root_dir, deadline_first);
+	pending.push_back("/");
+
+	phases.add("scan", {}, [&] {
+		shard_builder builder(scanned);
+		auto sink = [&](string&& path) { builder.add(std::move(path)); };
+		if (opt.locate) {
+			// the database is sorted: bring the first directories ahead
+			vector<pair<size_t, string>> fs;
+			scan_locate([&](string&& path) {
+				scanned_count++;
+				string top = shard_of(path);
+				fs.emplace_back(find(deadline_first.begin(), deadline_first.end(), top) - deadline_first.begin(), std::move(path));
+			}, opt.ignore_file, opt.root_dir);
+			stable_sort(fs.begin(), fs.end(), [](const pair<size_t, string>& a, const pair<size_t, string>& b) { return a.first < b.first; });
+			for (auto& path: fs)
+				sink(std::move(path.second));
+		} else {
+			scan_nolocate_ordered([&](string&& path) { scanned_count++; sink(std::move(path)); },
+			                      opt.ignore_file, opt.root_dir, deadline_first);
+		}
+		builder.finish();
+	});
+
+	phases.add("dpkg", {}, [&] {
+		dpkg_start(opt.root_dir);
+		read_dpkg(in.packages, dpkg, false, opt.root_dir);
+		dpkg_end();
+		lock_guard<mutex> lock(progress);
+		packages_count = in.packages.size();
+	});
+
+	phases.add("split dpkg", {"dpkg"}, [&] {
+		size_t count = dpkg.size();
+		for (auto& path: dpkg)
+			dpkg_shards[shard_of(path)].emplace_back(std::move(path));
+		dpkg.clear();
+		lock_guard<mutex> lock(progress);
+		dpkg_count = count;
+	});
+
+	phases.add("extra vs globs", {"split dpkg", "read filters", "read excludes"}, [&] {
+		{
+			lock_guard<mutex> lock(progress);
+			rules_count = in.globs.size();
+		}
+		const vector<string> none;
+		used_globs.assign(in.globs.size(), false);
+		auto add = [&](shard&& s) {
+			vector<string> missing2;
+			match_missing(s.missing, in.excludes, missing2, debug);
+			s.missing = std::move(missing2);
+			lock_guard<mutex> lock(progress);
+			pending.erase(remove(pending.begin(), pending.end(), s.name), pending.end());
+			classified.push_back(std::move(s));
+		};
+		shard s;
+		while (scanned.pop(s)) {
+			auto dp = dpkg_shards.find(s.name);
+			vector<string> cruft;
+			match_dpkg(s.paths, dp == dpkg_shards.end() ? none : dp->second, cruft, s.missing);
+			if (dp != dpkg_shards.end())
+				dpkg_shards.erase(dp);
+			s.paths.clear();
+			match_globs(cruft, in.globs, used_globs, s.paths);
+			add(std::move(s));
+		}
+		// whole top-level directories that are gone
+		for (auto& dp: dpkg_shards) {
+			s = shard();
+			s.name = dp.first;
+			s.missing = std::move(dp.second);
+			add(std::move(s));
+		}
+		// the directories left are empty
+		lock_guard<mutex> lock(progress);
+		pending.clear();
+	});
+
+	phases.add("explain", {"dpkg"}, [&] {
+		vector<owner> order;
+		list_explain_uppercase(opt.explain_dir, order);
+		list_explain_packages(opt.explain_dir, in.packages, order);
+		// the size of a script is the best guess of its cost at hand
+		vector<pair<off_t, owner>> sized;
+		for (auto& script: order) {
+			struct stat st;
+			sized.emplace_back(counted_stat(script.path.c_str(), &st) == 0 ? st.st_size : 0, std::move(script));
+		}
+		stable_sort(sized.begin(), sized.end(), [](const pair<off_t, owner>& a, const pair<off_t, owner>& b) { return a.first < b.first; });
+		{
+			lock_guard<mutex> lock(progress);
+			for (auto& script: sized)
+				scripts.push_back(std::move(script.second));
+		}
+		for (size_t i = 0;; i++) {
+			owner script("", "");
+			{
+				lock_guard<mutex> lock(progress);
+				if (i >= scripts.size())
+					break;
+				script = scripts[i];
 			}
+			vector<owner> found;
+			run_explain(script.path, script.package, found);
+			lock_guard<mutex> lock(progress);
+			explain.insert(explain.end(), found.begin(), found.end());
+			scripts[i].path.clear();
 		}
-		if (!match) cruft3.push_back(cr);
+	});
+
+	thread runner([&] {
+		phases.run();
+		lock_guard<mutex> lock(progress);
+		done = true;
+		finished.notify_all();
+	});
+
+	unique_lock<mutex> lock(progress);
+	finished.wait_until(lock, started + chrono::seconds(opt.deadline), [&done] { return done; });
+	bool in_time = done;
+	if (in_time) {
+		lock.unlock();
+		runner.join();
+		lock.lock();
+		if (debug) unused_globs(in.globs, used_globs);
 	}
-	if (debug)
-		for (size_t i = 0; i < globs.size(); i++)
-			if (!used_globs[i])
-				cout << "unused ruleset: " << globs[i].package << " " << globs[i].path << endl;
-	elapsed("extra vs globs");
-	if (debug) cerr << cruft3.size() << " files in cruft3 database\n\n";
 
-	// set CRUFT_ROOT for explain scripts
-	setenv("CRUFT_ROOT", root_dir == "/" ? "" : root_dir.c_str(), 0);
-	// match the dynamic "explain" filters
-	vector<owner> explain;
-	read_explain(explain_dir, packages, explain);
-	elapsed("read explain");
+	sort(explain.begin(), explain.end());
+	explain.erase( unique( explain.begin(), explain.end() ), explain.end() );
+	vector<string> missing2;
+	for (auto& s: classified) {
+		vector<string> cruft4;
+		match_explain(s.paths, explain, cruft4);
+		if (!cruft4.empty())
+			report_unexplained(s.name, cruft4, in.bugs);
+		missing2.insert(missing2.end(), s.missing.begin(), s.missing.end());
+	}
+	sort(missing2.begin(), missing2.end());
+	report_missing(missing2);
+
+	vector<string> not_run;
+	for (const auto& script: scripts)
+		if (!script.path.empty())
+			not_run.push_back(script.path);
+	report_not_covered("directories", pending);
+	report_not_covered("explain scripts", not_run);
+
+	report_count("scanned", scanned_count);
+	trace_paths(scanned_count);
+	report_count("dpkg", dpkg_count);
+	if (in_time) {
+		in.explain = std::move(explain);
+		return;
+	}
+
+	// the other phases still use 'in', so cruft() cannot take over
+	report_count("packages", packages_count);
+	report_count("rules", rules_count);
+	report_count("explained", explain.size());
+	if (in.bugs.loaded())
+		report_count("bugs", in.bugs.size());
+	progress_end(false);
+	bool exported = report_end(phases.timings());
+	exported = trace_end() && exported;
+	_exit(exported ? 0 : 1);
+}
+
+/* same pipeline as cruft_all() on a sample of the directories,
+   the report extrapolates from it, see estimate.h */
+static void cruft_estimate(const options& opt, scheduler& phases, inputs& in, bool debug)
+{
+	vector<string> fs;
+	vector<string> dpkg;
+	vector<string> cruft;
+	vector<string> missing;
+	vector<string> cruft3;
 	vector<string> cruft4;
-	for (const auto& cr: cruft3) {
-		bool match=false;
-		for (const auto& ex: explain) {
-			match=(cr==ex.path);
-			if (match) break;
-		}
-		if (!match) cruft4.push_back(cr);
+	unique_ptr<tree_sample> sample;
+
+	phases.add("sample", {}, [&] {
+		vector<string> ignores;
+		read_ignores(ignores, opt.ignore_file);
+		auto list = [&](const string& dir, vector<string>& entries, vector<string>& subdirs) {
+			list_nolocate(dir, ignores, opt.root_dir, entries, subdirs);
+		};
+		sample.reset(new tree_sample(list, opt.estimate, random_device()()));
+		fs = sample->paths();
+		if (debug) cerr << fs.size() << " files in " << sample->listed() << " directories sampled\n";
+	});
+
+	phases.add("dpkg", {}, [&] {
+		dpkg_start(opt.root_dir);
+		read_dpkg(in.packages, dpkg, false, opt.root_dir);
+		dpkg_end();
+	});
+
+	// most of what dpkg ships is not in the sample, so nothing is missing
+	phases.add("main set match", {"sample", "dpkg"}, [&] {
+		match_dpkg(fs, dpkg, cruft, missing);
+	});
+
+	phases.add("extra vs globs", {"main set match", "read filters"}, [&] {
+		vector<bool> used_globs;
+		match_globs(cruft, in.globs, used_globs, cruft3);
+	});
+
+	phases.add("extra vs explain", {"extra vs globs", "merge explain"}, [&] {
+		match_explain(cruft3, in.explain, cruft4);
+	});
+
+	phases.add("report", {"extra vs explain"}, [&] {
+		report_count("scanned", fs.size());
+		trace_paths(fs.size());
+		report_count("dpkg", dpkg.size());
+		report_count("listed", sample->listed());
+		report_count("walks", sample->walks());
+
+		vector<estimate_totals> totals;
+		sample->estimate(cruft4, [&opt](const string& path) -> uint64_t {
+			struct stat st;
+			string real = opt.root_dir + path.substr(1);
+			if (counted_lstat(real.c_str(), &st) != 0 || S_ISDIR(st.st_mode))
+				return 0;
+			return st.st_size;
+		}, totals);
+		for (const auto& t: totals)
+			report_estimate(t);
+	});
+
+	phases.run();
+}
+#endif
+
+static void cruft(const options& opt)
+{
+	bool debug = getenv("DEBUG") != nullptr;
+	trace_start(opt.trace_file);
+	progress_start(opt.progress, progress_file);
+
+	const int SIZEBUF = 200;
+	char buf[SIZEBUF];
+	time_t rawtime;
+	struct tm * timeinfo;
+	time(&rawtime);
+	timeinfo=localtime(&rawtime);
+	setlocale(LC_TIME, "");
+	strftime(buf, sizeof(buf), "%c", timeinfo);
+
+	report_origin origin;
+	origin.date = buf;
+	if (gethostname(buf, sizeof(buf)) == 0) {
+		buf[SIZEBUF - 1] = '\0';
+		origin.host = buf;
 	}
-	elapsed("extra vs explain");
+	origin.root_dir = opt.root_dir;
+	origin.as_root = geteuid() == 0;
 
-	if (debug) cerr << cruft4.size() << " files in cruft4 database\n";
+	inputs in(opt);
+	// a replay looks like the recorded run
+	vector<string> recorded;
+	if (!opt.replay_file.empty()) {
+		if (!in.saved.read(opt.replay_file) || !in.saved.get("origin", recorded) || recorded.size() != 4) {
+			cerr << "cannot replay " << opt.replay_file << '\n';
+			exit(1);
+		}
+		origin.date = recorded[0];
+		origin.host = recorded[1];
+		origin.as_root = recorded[3] == "root";
+		vector<string> records;
+		vector<pair<string, bug>> bugs;
+		in.saved.get("bugs", records);
+		for (size_t i = 0; i + 3 <= records.size(); i += 3)
+			bugs.emplace_back(records[i], bug(records[i + 2], records[i + 1]));
+		in.bugs.replace(bugs);
+	}
 
-	//TODO: some smarter algo when run as non-root
-        //      like checking the R/X bits of parent dir
-	cout << "---- missing: dpkg ----\n";
-	if (geteuid() == 0 ) for (const auto& miss: missing2) {
-		cout << "        " << miss << '\n';
+#ifdef BUSTER
+	origin.backend = "mlocate";
+	origin.mode = "all";
+#else
+	origin.backend = !opt.replay_file.empty() ? recorded[2] : opt.locate ? "plocate" : "nolocate";
+	origin.mode = opt.stream ? "stream" : opt.split_fs ? "split-fs" : opt.max_memory ? "max-memory" : opt.deadline ? "deadline" : opt.estimate ? "estimate" : "all";
+#endif
+	origin.ruleset_file = opt.ruleset_file;
+	origin.filter_dir = opt.filter_dir;
+	origin.explain_dir = opt.explain_dir;
+	origin.bugs_file = opt.bugs_file;
+	report_start(opt.format, origin);
+	if (!opt.export_file.empty())
+		report_export(opt.export_file);
+	if (!opt.delta_file.empty())
+		report_delta(opt.delta_file);
+	if (!opt.metrics_file.empty()) {
+#ifdef BUSTER
+		report_metrics(opt.metrics_file, [](const string&) { return string("/"); });
+#else
+		vector<mount> mounts;
+		// those of this system say nothing of a recorded one
+		if (opt.replay_file.empty() && read_mounts(mounts, opt.root_dir) != 0)
+			mounts.clear();
+		if (mounts.empty())
+			mounts.push_back({"/", "", ""});
+		report_metrics(opt.metrics_file, [mounts](const string& path) { return mount_of(path, mounts).point; });
+#endif
 	}
 
-	//TODO: split by filesystem
-	cout << "---- unexplained: / ----\n";
-	for (const auto& cr: cruft4) {
-		cout << "        " << cr;
-		auto bug = bugs.find(cr);
-		if (bug != bugs.end()) {
-			cout << "       (Bug: #" << bug->second.bugno << ")";
+	if (opt.locate && opt.replay_file.empty()) {
+		trace_span span("updatedb");
+		bool updated = updatedb();
+		if (!updated) {
+			cerr << "warning: plocate database is outdated" << endl << flush;
 		}
-		cout << '\n';
 	}
 
-	cout << "\nend.\n";
-	exit(0);
+	// set CRUFT_ROOT for explain scripts
+	setenv("CRUFT_ROOT", opt.root_dir == "/" ? "" : opt.root_dir.c_str(), 0);
+
+	scheduler phases;
+	read_inputs(opt, phases, in);
+
+#ifndef BUSTER
+	if (opt.stream)
+		cruft_stream(opt, phases, in, debug);
+	else if (opt.split_fs)
+		cruft_split_fs(opt, phases, in, debug);
+	else if (opt.max_memory)
+		cruft_low_memory(opt, phases, in, debug);
+	else if (opt.deadline)
+		cruft_deadline(opt, phases, in, debug);
+	else if (opt.estimate)
+		cruft_estimate(opt, phases, in, debug);
+	else
+#endif
+		cruft_all(opt, phases, in, debug);
+
+	report_count("packages", in.packages.size());
+	report_count("rules", in.globs.size());
+	report_count("explained", in.explain.size());
+	// the known bugs are only read once something is unexplained
+	if (in.bugs.loaded())
+		report_count("bugs", in.bugs.size());
+	// another root, a replay or a partial scan would give the next run a wrong ETA
+	progress_end(opt.replay_file.empty() && opt.root_dir == "/" && !opt.deadline && !opt.estimate);
+	bool exported = report_end(phases.timings());
+
+	if (!opt.record_file.empty()) {
+		// not used by the replay, kept to see what the scan left out
+		vector<string> ignores;
+		read_ignores(ignores, opt.ignore_file);
+		in.saved.put("ignore", ignores);
+		in.saved.put("origin", {origin.date, origin.host, origin.backend, origin.as_root ? "root" : "user"});
+		vector<pair<string, bug>> bugs;
+		in.bugs.entries(bugs);
+		vector<string> records;
+		for (const auto& b: bugs) {
+			records.push_back(b.first);
+			records.push_back(b.second.bugno);
+			records.push_back(b.second.package);
+		}
+		in.saved.put("bugs", records);
+		exported = in.saved.write(opt.record_file) && exported;
+	}
+	exported = trace_end() && exported;
+	exit(exported ? 0 : 1);
 }
 
 int main(int argc, char *argv[])
 {
 	bool do_one_package = false;
-	bool locate = true;
 	string package = "";
-	string explain_dir = default_explain_dir;
-	string filter_dir = default_filter_dir;
-	string ignore_file = default_ignore_file;
-	string ruleset_file = default_ruleset_file;
-	string bugs_file = default_bugs_file;
-	string root_dir = default_root_dir;
+	options o;
 
 	const struct option long_options[] =
 	{
@@ -391,11 +1115,26 @@ int main(int argc, char *argv[])
 		{"ruleset", required_argument, nullptr, 'R'},
 		{"bugs", required_argument, nullptr, 'B'},
 		{"root", required_argument, nullptr, 'r'},
+		{"stream", no_argument, nullptr, 's'},
+		{"max-memory", required_argument, nullptr, 'm'},
+		{"split-fs", no_argument, nullptr, 'f'},
+		{"collapse", no_argument, nullptr, 'c'},
+		{"format", required_argument, nullptr, 'o'},
+		{"export", required_argument, nullptr, 'x'},
+		{"delta", required_argument, nullptr, 'd'},
+		{"cache", required_argument, nullptr, 'k'},
+		{"deadline", required_argument, nullptr, 't'},
+		{"estimate", required_argument, nullptr, option_estimate},
+		{"record", required_argument, nullptr, option_record},
+		{"replay", required_argument, nullptr, option_replay},
+		{"trace", required_argument, nullptr, option_trace},
+		{"metrics", required_argument, nullptr, option_metrics},
+		{"progress", no_argument, nullptr, option_progress},
 		{0, 0, 0, 0}
 	};
 
 	int opt, opti = 0;
-	while ((opt = getopt_long(argc, argv, "p:E:F:hI:nR:B:r:", long_options, &opti)) != 0) {
+	while ((opt = getopt_long(argc, argv, "p:E:F:hI:nR:B:r:sm:fco:x:d:k:t:", long_options, &opti)) != 0) {
 		if (opt == EOF)
 			break;
 
@@ -405,15 +1144,15 @@ int main(int argc, char *argv[])
 			package = optarg;
 			break;
 		case 'E':
-			explain_dir = optarg;
-			if (!explain_dir.empty() && explain_dir.back() != '/')
-				explain_dir += '/';
+			o.explain_dir = optarg;
+			if (!o.explain_dir.empty() && o.explain_dir.back() != '/')
+				o.explain_dir += '/';
 			break;
 
 		case 'F':
-			filter_dir = optarg;
-			if (!filter_dir.empty() && filter_dir.back() != '/')
-				filter_dir += '/';
+			o.filter_dir = optarg;
+			if (!o.filter_dir.empty() && o.filter_dir.back() != '/')
+				o.filter_dir += '/';
 			break;
 
 		case 'h':
@@ -421,29 +1160,116 @@ int main(int argc, char *argv[])
 			exit(0);
 
 		case 'I':
-			ignore_file = optarg;
+			o.ignore_file = optarg;
 			break;
 
 		case 'n':
-			locate = false;
+			o.locate = false;
 			break;
 
 		case 'R':
-			ruleset_file = optarg;
+			o.ruleset_file = optarg;
 			break;
 
 		case 'B':
-			bugs_file = optarg;
+			o.bugs_file = optarg;
 			break;
 
 		case '?':
 			print_help_message();
 			exit(1);
 
+		case 's':
+			o.stream = true;
+			break;
+
+		case 'f':
+			o.split_fs = true;
+			break;
+
+		case 'c':
+			o.collapse = true;
+			break;
+
+		case 'o':
+			if (!parse_report_format(optarg, o.format)) {
+				print_help_message();
+				exit(1);
+			}
+			break;
+
+		case 'x':
+			o.export_file = optarg;
+			break;
+
+		case 'd':
+			o.delta_file = optarg;
+			break;
+
+		case 'k':
+			o.cache_file = optarg;
+			break;
+
+		case option_estimate:
+			try {
+				o.estimate = stoul(optarg);
+				if (o.estimate == 0)
+					throw invalid_argument(optarg);
+				// the sample is listed from the filesystem
+				o.locate = false;
+			} catch(...) {
+				print_help_message();
+				exit(1);
+			}
+			break;
+
+		case option_record:
+			o.record_file = optarg;
+			break;
+
+		case option_replay:
+			o.replay_file = optarg;
+			break;
+
+		case option_trace:
+			o.trace_file = optarg;
+			break;
+
+		case option_metrics:
+			o.metrics_file = optarg;
+			break;
+
+		case option_progress:
+			o.progress = true;
+			break;
+
+		case 't':
+			try {
+				o.deadline = stol(optarg);
+				if (o.deadline <= 0)
+					throw invalid_argument(optarg);
+			} catch(...) {
+				print_help_message();
+				exit(1);
+			}
+			break;
+
+		case 'm':
+			try {
+				o.max_memory = stoul(optarg) << 20;
+				// shared by three sorters, each spilling runs of its share
+				if (o.max_memory < max_memory_min << 20)
+					throw invalid_argument(optarg);
+			} catch(...) {
+				print_help_message();
+				exit(1);
+			}
+			break;
+
 		case 'r':
-			root_dir = optarg;
-			if (!root_dir.empty() && root_dir.back() != '/')
-				root_dir += '/';
+			o.root_dir = optarg;
+			if (!o.root_dir.empty() && o.root_dir.back() != '/')
+				o.root_dir += '/';
 			break;
 
 	        default:
@@ -455,6 +1281,47 @@ int main(int argc, char *argv[])
 
 	if (do_one_package) exit(one_package(package));
 
+	// each of them is a mode of its own
+	if (o.stream + o.split_fs + bool(o.max_memory) + bool(o.deadline) > 1) {
+		cerr << "only one of --stream, --split-fs, --max-memory and --deadline can be used\n";
+		exit(1);
+	}
+
+	// only the default mode and --split-fs keep the lists collapse() folds
+	if (o.collapse && (o.stream || o.max_memory || o.deadline)) {
+		cerr << "--collapse does not work with --stream, --max-memory or --deadline\n";
+		exit(1);
+	}
+
+	// the other modes match their globs without the cache
+	if (!o.cache_file.empty() && (o.stream || o.split_fs || o.max_memory || o.deadline)) {
+		cerr << "--cache only works in the default mode\n";
+		exit(1);
+	}
+
+	// a partial report would make everything not covered look gone
+	if (o.deadline && !o.delta_file.empty()) {
+		cerr << "--deadline and --delta cannot be used together\n";
+		exit(1);
+	}
+
+	// a sample says nothing of what is missing or of each path
+	if (o.estimate && (o.stream || o.split_fs || o.max_memory || o.deadline || o.collapse
+	                   || !o.export_file.empty() || !o.delta_file.empty() || !o.cache_file.empty())) {
+		cerr << "--estimate only works alone\n";
+		exit(1);
+	}
+
+	// only the default mode keeps all its inputs in memory, and the other
+	// options would look at the files again or write state of their own
+	if ((!o.record_file.empty() || !o.replay_file.empty())
+	    && (o.stream || o.split_fs || o.max_memory || o.deadline || o.estimate || o.collapse
+	        || !o.export_file.empty() || !o.delta_file.empty() || !o.cache_file.empty()
+	        || (!o.record_file.empty() && !o.replay_file.empty()))) {
+		cerr << "--record and --replay only work alone, in the default mode\n";
+		exit(1);
+	}
+
 	if (optind < argc) {
 		if (optind + 1 == argc)
 			one_file(argv[1]);
@@ -468,5 +1335,5 @@ int main(int argc, char *argv[])
 	}
 
 	// else: standard cruft report
-	cruft(ignore_file, filter_dir, ruleset_file, explain_dir, bugs_file, locate, root_dir);
+	cruft(o);
 }
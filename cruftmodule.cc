@@ -0,0 +1,298 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/* the rule engine of cruft-ng for Python, so that the tools checking
+   the rules need neither to parse them again nor to run dpkg-query:
+
+     import cruft
+     packages, files = cruft.dpkg()
+     rules = cruft.read_filters('/etc/cruft/filters/', '/usr/share/cruft/ruleset', packages)
+     used, unmatched = cruft.match_globs(paths, rules)
+
+   paths are str, decoded like os.fsdecode() does */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "dpkg.h"
+#include "filters.h"
+#include "match.h"
+#include "shellexp.h"
+
+// a str or bytes, as the file system sees it
+static bool to_string(PyObject* object, string& value)
+{
+	PyObject* bytes = nullptr;
+	if (!PyUnicode_FSConverter(object, &bytes))
+		return false;
+	value.assign(PyBytes_AS_STRING(bytes), PyBytes_GET_SIZE(bytes));
+	Py_DECREF(bytes);
+	return true;
+}
+
+static PyObject* from_string(const string& value)
+{
+	return PyUnicode_DecodeFSDefaultAndSize(value.data(), value.size());
+}
+
+static bool to_strings(PyObject* sequence, vector<string>& values)
+{
+	PyObject* fast = PySequence_Fast(sequence, "expected a sequence of paths");
+	if (!fast)
+		return false;
+	Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+	values.resize(n);
+	for (Py_ssize_t i = 0; i < n; i++) {
+		if (!to_string(PySequence_Fast_GET_ITEM(fast, i), values[i])) {
+			Py_DECREF(fast);
+			return false;
+		}
+	}
+	Py_DECREF(fast);
+	return true;
+}
+
+static PyObject* from_strings(const vector<string>& values)
+{
+	PyObject* list = PyList_New(values.size());
+	if (!list)
+		return nullptr;
+	for (size_t i = 0; i < values.size(); i++) {
+		PyObject* item = from_string(values[i]);
+		if (!item) {
+			Py_DECREF(list);
+			return nullptr;
+		}
+		PyList_SET_ITEM(list, i, item);
+	}
+	return list;
+}
+
+// the rules as (package, glob) tuples
+static bool to_rules(PyObject* sequence, vector<owner>& rules)
+{
+	PyObject* fast = PySequence_Fast(sequence, "expected a sequence of (package, glob)");
+	if (!fast)
+		return false;
+	Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+	rules.reserve(n);
+	for (Py_ssize_t i = 0; i < n; i++) {
+		PyObject* rule = PySequence_Fast_GET_ITEM(fast, i);
+		PyObject* package;
+		PyObject* glob;
+		string p, g;
+		if (!PyTuple_Check(rule))
+			PyErr_SetString(PyExc_TypeError, "expected (package, glob)");
+		else if (PyArg_ParseTuple(rule, "OO;expected (package, glob)", &package, &glob)
+		         && to_string(package, p) && to_string(glob, g)) {
+			rules.emplace_back(p, g);
+			continue;
+		}
+		Py_DECREF(fast);
+		return false;
+	}
+	Py_DECREF(fast);
+	return true;
+}
+
+static PyObject* from_rules(const vector<owner>& rules)
+{
+	PyObject* list = PyList_New(rules.size());
+	if (!list)
+		return nullptr;
+	for (size_t i = 0; i < rules.size(); i++) {
+		PyObject* package = from_string(rules[i].package);
+		PyObject* glob = package ? from_string(rules[i].path) : nullptr;
+		PyObject* item = glob ? PyTuple_Pack(2, package, glob) : nullptr;
+		Py_XDECREF(package);
+		Py_XDECREF(glob);
+		if (!item) {
+			Py_DECREF(list);
+			return nullptr;
+		}
+		PyList_SET_ITEM(list, i, item);
+	}
+	return list;
+}
+
+PyDoc_STRVAR(read_filters_doc,
+"read_filters(filter_dir, ruleset_file, packages) -> [(package, glob)]\n\n"
+"The rules cruft uses for these installed packages: the uppercase files and\n"
+"those named after a package in filter_dir (ending with '/'), the rules shipped\n"
+"by the packages and their part of the ruleset file.");
+
+static PyObject* py_read_filters(PyObject*, PyObject* args)
+{
+	PyObject* dir_arg;
+	PyObject* ruleset_arg;
+	PyObject* packages_arg;
+	if (!PyArg_ParseTuple(args, "OOO:read_filters", &dir_arg, &ruleset_arg, &packages_arg))
+		return nullptr;
+	string dir, ruleset_file;
+	vector<string> packages;
+	if (!to_string(dir_arg, dir) || !to_string(ruleset_arg, ruleset_file) || !to_strings(packages_arg, packages))
+		return nullptr;
+
+	// read_filters() exits when it cannot list the directory
+	struct stat st;
+	if (stat(dir.c_str(), &st) != 0)
+		return PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, dir_arg);
+	if (!S_ISDIR(st.st_mode)) {
+		errno = ENOTDIR;
+		return PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, dir_arg);
+	}
+
+	vector<owner> rules;
+	Py_BEGIN_ALLOW_THREADS
+	read_filters(dir, ruleset_file, packages, rules);
+	Py_END_ALLOW_THREADS
+	return from_rules(rules);
+}
+
+PyDoc_STRVAR(read_ruleset_doc,
+"read_ruleset(ruleset_file) -> [(package, glob)]\n\n"
+"Every rule of the ruleset file, whatever is installed.");
+
+static PyObject* py_read_ruleset(PyObject*, PyObject* args)
+{
+	PyObject* ruleset_arg;
+	if (!PyArg_ParseTuple(args, "O:read_ruleset", &ruleset_arg))
+		return nullptr;
+	string ruleset_file;
+	if (!to_string(ruleset_arg, ruleset_file))
+		return nullptr;
+
+	vector<owner> rules;
+	Py_BEGIN_ALLOW_THREADS
+	read_ruleset(ruleset_file, rules);
+	Py_END_ALLOW_THREADS
+	return from_rules(rules);
+}
+
+PyDoc_STRVAR(myglob_doc,
+"myglob(path, glob) -> bool\n\n"
+"Whether the rule glob matches path, as cruft matches it: '*' and '?'\n"
+"stop at '/', only '/**' goes through directories.");
+
+static PyObject* py_myglob(PyObject*, PyObject* args)
+{
+	PyObject* path_arg;
+	PyObject* glob_arg;
+	if (!PyArg_ParseTuple(args, "OO:myglob", &path_arg, &glob_arg))
+		return nullptr;
+	string path, glob;
+	if (!to_string(path_arg, path) || !to_string(glob_arg, glob))
+		return nullptr;
+	return PyBool_FromLong(myglob(path, glob));
+}
+
+PyDoc_STRVAR(match_globs_doc,
+"match_globs(paths, rules) -> (used, unmatched)\n\n"
+"Match the paths against the (package, glob) rules like cruft does:\n"
+"used[i] tells whether rules[i] matched any path, unmatched lists the\n"
+"paths no rule matches, sorted.");
+
+static PyObject* py_match_globs(PyObject*, PyObject* args)
+{
+	PyObject* paths_arg;
+	PyObject* rules_arg;
+	if (!PyArg_ParseTuple(args, "OO:match_globs", &paths_arg, &rules_arg))
+		return nullptr;
+	vector<string> paths;
+	vector<owner> rules;
+	if (!to_strings(paths_arg, paths) || !to_rules(rules_arg, rules))
+		return nullptr;
+
+	vector<bool> used;
+	vector<string> unmatched;
+	Py_BEGIN_ALLOW_THREADS
+	sort(paths.begin(), paths.end());
+	paths.erase(unique(paths.begin(), paths.end()), paths.end());
+	match_globs(paths, rules, used, unmatched);
+	Py_END_ALLOW_THREADS
+
+	PyObject* used_list = PyList_New(used.size());
+	if (!used_list)
+		return nullptr;
+	for (size_t i = 0; i < used.size(); i++)
+		PyList_SET_ITEM(used_list, i, PyBool_FromLong(used[i]));
+	PyObject* unmatched_list = from_strings(unmatched);
+	if (!unmatched_list) {
+		Py_DECREF(used_list);
+		return nullptr;
+	}
+	return Py_BuildValue("(NN)", used_list, unmatched_list);
+}
+
+PyDoc_STRVAR(dpkg_doc,
+"dpkg(root_dir='/') -> (packages, files)\n\n"
+"The installed packages, and the files they ship as (path, package),\n"
+"read from the dpkg database below root_dir (ending with '/'), with the\n"
+"paths /usr-merged like cruft sees them.");
+
+static PyObject* py_dpkg(PyObject*, PyObject* args)
+{
+	PyObject* root_arg = nullptr;
+	if (!PyArg_ParseTuple(args, "|O:dpkg", &root_arg))
+		return nullptr;
+	string root_dir = "/";
+	if (root_arg && !to_string(root_arg, root_dir))
+		return nullptr;
+
+	vector<string> packages;
+	vector<pair<string, string>> files;
+	// libdpkg keeps its database in globals: the GIL is kept so that
+	// two threads never read it at once
+	dpkg_start(root_dir);
+	scan_dpkg(packages, [&files](string&& path, const char* package) {
+		files.emplace_back(std::move(path), package);
+	}, false, root_dir);
+	dpkg_end();
+
+	PyObject* packages_list = from_strings(packages);
+	PyObject* files_list = packages_list ? PyList_New(files.size()) : nullptr;
+	if (!files_list) {
+		Py_XDECREF(packages_list);
+		return nullptr;
+	}
+	for (size_t i = 0; i < files.size(); i++) {
+		PyObject* path = from_string(files[i].first);
+		PyObject* package = path ? from_string(files[i].second) : nullptr;
+		PyObject* item = package ? PyTuple_Pack(2, path, package) : nullptr;
+		Py_XDECREF(path);
+		Py_XDECREF(package);
+		if (!item) {
+			Py_DECREF(packages_list);
+			Py_DECREF(files_list);
+			return nullptr;
+		}
+		PyList_SET_ITEM(files_list, i, item);
+	}
+	return Py_BuildValue("(NN)", packages_list, files_list);
+}
+
+static PyMethodDef methods[] = {
+	{"read_filters", py_read_filters, METH_VARARGS, read_filters_doc},
+	{"read_ruleset", py_read_ruleset, METH_VARARGS, read_ruleset_doc},
+	{"myglob", py_myglob, METH_VARARGS, myglob_doc},
+	{"match_globs", py_match_globs, METH_VARARGS, match_globs_doc},
+	{"dpkg", py_dpkg, METH_VARARGS, dpkg_doc},
+	{nullptr, nullptr, 0, nullptr}
+};
+
+static struct PyModuleDef module = {
+	PyModuleDef_HEAD_INIT,
+	"cruft",
+	"The rule engine and the dpkg database reader of cruft-ng.",
+	-1,
+	methods,
+	nullptr, nullptr, nullptr, nullptr
+};
+
+PyMODINIT_FUNC PyInit_cruft(void)
+{
+	return PyModule_Create(&module);
+}
@@ -0,0 +1,503 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <getopt.h>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "libcruft.h"
+#include "usr_merge.h"
+
+#ifndef BUSTER
+#include "watch.h"
+#endif
+
+using namespace std;
+
+/* keeps a cruft_engine loaded and answers queries on a Unix socket,
+   one request per line, each answer ends with an empty line:
+
+     owner PATH     static PACKAGE | explained PACKAGE | unexplained
+     cruft DIR      unexplained PATH... then missing PATH...
+     report         same as "cruft /"
+     reload         reloaded
+
+   the dpkg database and the rules are read again before answering
+   when they changed; the requests are answered one at a time, from
+   whichever client sent a complete one
+
+   with --watch, the unexplained and missing files are classified once,
+   then kept up to date from the fanotify events, so that "cruft" and
+   "report" only cost their output */
+
+static const char* const default_socket = "/run/cruft-ng.sock";
+
+// a client idle for this many seconds is dropped
+static const int client_timeout = 10;
+// nor can a request grow without end
+static const size_t max_request = 64 * 1024;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int)
+{
+	stopping = 1;
+}
+
+static time_t mtime(const string& path)
+{
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 ? st.st_mtim.tv_sec : 0;
+}
+
+// the newest of a directory and of the files in it
+static time_t newest(const string& dir)
+{
+	time_t newest = mtime(dir);
+	DIR* dp = opendir(dir.c_str());
+	if (dp == nullptr)
+		return newest;
+	while (struct dirent* dirp = readdir(dp))
+		if (dirp->d_name[0] != '.')
+			newest = max(newest, mtime(dir + '/' + dirp->d_name));
+	closedir(dp);
+	return newest;
+}
+
+class daemon_state
+{
+public:
+	explicit daemon_state(const cruft_config& config) : config(config), engine(config) {}
+
+	// keep 'unexplained' and 'missing' up to date, see apply()
+	void track()
+	{
+		tracking = true;
+		rescan("/");
+	}
+
+	// load what changed since the last call
+	void refresh(bool force = false)
+	{
+		time_t dpkg = mtime(config.root_dir + "var/lib/dpkg/status");
+		time_t rules = max({mtime(config.ruleset_file), newest(config.filter_dir),
+		                    newest(config.explain_dir), newest("/usr/libexec/cruft")});
+		bool debug = getenv("DEBUG") != nullptr;
+		if (force || dpkg != dpkg_stamp) {
+			if (debug) cerr << "reading the dpkg database\n";
+			engine.load_dpkg();
+			dpkg_stamp = dpkg;
+			// the filters and explain scripts depend on the installed packages
+			rules_stamp = 0;
+		}
+		if (rules != rules_stamp) {
+			if (debug) cerr << "reading the rules\n";
+			engine.load_rules();
+			rules_stamp = rules;
+			if (tracking)
+				rescan("/");
+		}
+	}
+
+#ifndef BUSTER
+	void apply(const fs_change& change)
+	{
+		if (engine.ignored(change.path))
+			return;
+		unexplained.erase(change.path);
+		missing.erase(change.path);
+		string package;
+		if (change.exists) {
+			if (engine.owner(change.path, package) == cruft_unexplained)
+				unexplained.insert(change.path);
+		} else if (engine.missing(change.path)) {
+			missing.insert(change.path);
+		}
+		// a directory moved in or away comes with its content
+		if (change.directory)
+			rescan(change.path);
+	}
+#endif
+
+	void answer(const string& request, string& out)
+	{
+		size_t space = request.find(' ');
+		string verb = request.substr(0, space);
+		string arg = space == string::npos ? "" : request.substr(space + 1);
+
+		if (verb == "reload") {
+			refresh(true);
+			out += "reloaded\n";
+			return;
+		}
+		refresh();
+		if (verb == "owner" && !arg.empty() && arg[0] == '/') {
+			string package;
+			switch (engine.owner(usr_merge(arg), package)) {
+			case cruft_static: out += "static " + package + '\n'; break;
+			case cruft_explained: out += "explained " + package + '\n'; break;
+			case cruft_unexplained: out += "unexplained\n"; break;
+			}
+		} else if (tracking && ((verb == "cruft" && !arg.empty() && arg[0] == '/') || (verb == "report" && arg.empty()))) {
+			string dir = verb == "report" || arg == "/" ? "/" : arg;
+			if (dir.size() > 1 && dir.back() == '/')
+				dir.pop_back();
+			for (auto it = below(unexplained, dir); it.first != it.second; ++it.first)
+				out += "unexplained " + *it.first + '\n';
+			for (auto it = below(missing, dir); it.first != it.second; ++it.first)
+				out += "missing " + *it.first + '\n';
+		} else if ((verb == "cruft" && !arg.empty() && arg[0] == '/') || (verb == "report" && arg.empty())) {
+			engine.scan(verb == "report" ? "/" : arg);
+			cruft_result result;
+			engine.classify(result);
+			for (const auto& path: result.unexplained)
+				out += "unexplained " + path + '\n';
+			for (const auto& path: result.missing)
+				out += "missing " + path + '\n';
+		} else {
+			out += "error: unknown request\n";
+		}
+	}
+
+	// classify 'dir' again, after a dropped event or a directory move
+	void rescan(const string& dir)
+	{
+		engine.scan(dir);
+		cruft_result result;
+		engine.classify(result);
+		auto gone = below(unexplained, dir);
+		unexplained.erase(gone.first, gone.second);
+		gone = below(missing, dir);
+		missing.erase(gone.first, gone.second);
+		unexplained.insert(result.unexplained.begin(), result.unexplained.end());
+		missing.insert(result.missing.begin(), result.missing.end());
+	}
+
+private:
+	typedef pair<set<string>::iterator, set<string>::iterator> range;
+
+	// the paths strictly below 'dir'
+	static range below(set<string>& paths, const string& dir)
+	{
+		if (dir == "/")
+			return {paths.begin(), paths.end()};
+		// '0' comes right after '/'
+		return {paths.lower_bound(dir + '/'), paths.lower_bound(dir + '0')};
+	}
+
+	cruft_config config;
+	cruft_engine engine;
+	time_t dpkg_stamp = 0;
+	time_t rules_stamp = 0;
+	bool tracking = false;
+	set<string> unexplained;
+	set<string> missing;
+};
+
+static void send_all(int fd, const string& data)
+{
+	for (size_t done = 0; done < data.size();) {
+		ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return; // the client went away
+		done += n;
+	}
+}
+
+/* the clients are served from the poll() loop on non-blocking sockets,
+   so that a slow or idle one holds neither the others nor the fanotify
+   queue; only answering a request takes the loop */
+struct client
+{
+	int fd;
+	string in;      // the start of a request
+	string out;     // answers not sent yet
+	bool eof = false;
+	time_t active;
+};
+
+// send what the socket takes; false once the client is done with
+static bool flush(client& c)
+{
+	while (!c.out.empty()) {
+		ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true;
+		if (n <= 0)
+			return false; // the client went away
+		c.out.erase(0, n);
+	}
+	return !c.eof;
+}
+
+// read what the client sent and answer its complete requests
+static bool serve(client& c, daemon_state& state)
+{
+	char buf[4096];
+	for (;;) {
+		ssize_t n = read(c.fd, buf, sizeof(buf));
+		if (n > 0) {
+			c.in.append(buf, n);
+			continue;
+		}
+		if (n == 0)
+			c.eof = true;
+		else if (errno == EINTR)
+			continue;
+		else if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return false;
+		break;
+	}
+	size_t eol;
+	while ((eol = c.in.find('\n')) != string::npos) {
+		string request = c.in.substr(0, eol);
+		c.in.erase(0, eol + 1);
+		state.answer(request, c.out);
+		c.out += '\n';
+	}
+	if (c.in.size() > max_request)
+		return false;
+	return flush(c);
+}
+
+static bool socket_address(const string& path, struct sockaddr_un& addr)
+{
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		cerr << "socket path too long: " << path << '\n';
+		return false;
+	}
+	strcpy(addr.sun_path, path.c_str());
+	return true;
+}
+
+// client side: send one request and print the answer
+static int query(const string& socket_path, const string& request)
+{
+	struct sockaddr_un addr;
+	if (!socket_address(socket_path, addr))
+		return 1;
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+		cerr << "cannot connect to " << socket_path << ": " << strerror(errno) << '\n';
+		return 1;
+	}
+	send_all(fd, request + '\n');
+	shutdown(fd, SHUT_WR);
+
+	string answer;
+	char buf[4096];
+	ssize_t n;
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+		answer.append(buf, n);
+	close(fd);
+	// without the empty line that ends it
+	if (!answer.empty() && answer.back() == '\n')
+		answer.pop_back();
+	cout << answer;
+	return answer.compare(0, 7, "error: ") == 0 ? 1 : 0;
+}
+
+static void usage()
+{
+	cerr << "usage: cruft-daemon [OPTIONS]\n";
+	cerr << "       cruft-daemon [-S SOCKET] -q REQUEST\n\n";
+	cerr << "answer owner, cruft and report requests on a Unix socket\n\n";
+	cerr << "    -S --socket      socket path (default: " << default_socket << ")\n";
+	cerr << "    -q --query       send this request to the running daemon and print the answer\n";
+	cerr << "    -E --explain     directory for explain scripts\n";
+	cerr << "    -F --filter      directory for filters\n";
+	cerr << "    -I --ignore      path for ignore file\n";
+	cerr << "    -R --ruleset     path for ruleset file\n";
+#ifndef BUSTER
+	cerr << "    -r --root        root directory\n";
+	cerr << "    -l --locate      scan with plocate, instead of walking the filesystem\n";
+	cerr << "    -w --watch       follow the filesystem changes with fanotify, instead of scanning on each request\n";
+#endif
+}
+
+static string with_slash(const char* dir)
+{
+	string s = dir;
+	if (!s.empty() && s.back() != '/')
+		s += '/';
+	return s;
+}
+
+int main(int argc, char *argv[])
+{
+	string socket_path = default_socket;
+	string request;
+	bool do_query = false;
+	bool watch = false;
+	cruft_config config;
+#ifndef BUSTER
+	// walking one subtree is cheaper than going through the whole database
+	config.locate = false;
+#endif
+
+	const struct option long_options[] =
+	{
+		{"help", no_argument, nullptr, 'h'},
+		{"socket", required_argument, nullptr, 'S'},
+		{"query", required_argument, nullptr, 'q'},
+		{"explain", required_argument, nullptr, 'E'},
+		{"filter", required_argument, nullptr, 'F'},
+		{"ignore", required_argument, nullptr, 'I'},
+		{"ruleset", required_argument, nullptr, 'R'},
+		{"root", required_argument, nullptr, 'r'},
+		{"locate", no_argument, nullptr, 'l'},
+		{"watch", no_argument, nullptr, 'w'},
+		{0, 0, 0, 0}
+	};
+
+	int opt, opti = 0;
+	while ((opt = getopt_long(argc, argv, "hS:q:E:F:I:R:r:lw", long_options, &opti)) != EOF) {
+		switch (opt) {
+		case 'S': socket_path = optarg; break;
+		case 'q': request = optarg; do_query = true; break;
+		case 'E': config.explain_dir = with_slash(optarg); break;
+		case 'F': config.filter_dir = with_slash(optarg); break;
+		case 'I': config.ignore_file = optarg; break;
+		case 'R': config.ruleset_file = optarg; break;
+#ifndef BUSTER
+		case 'r': config.root_dir = with_slash(optarg); break;
+		case 'l': config.locate = true; break;
+		case 'w': watch = true; break;
+#endif
+		case 'h':
+			usage();
+			return 0;
+		default:
+			usage();
+			return 1;
+		}
+	}
+	if (optind < argc) {
+		usage();
+		return 1;
+	}
+	if (do_query)
+		return query(socket_path, request);
+
+	struct sockaddr_un addr;
+	if (!socket_address(socket_path, addr))
+		return 1;
+	int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listener < 0) {
+		perror("socket");
+		return 1;
+	}
+	// a socket left behind by a previous daemon
+	unlink(socket_path.c_str());
+	mode_t mask = umask(0077);
+	if (bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listener, 16) != 0) {
+		cerr << "cannot listen on " << socket_path << ": " << strerror(errno) << '\n';
+		return 1;
+	}
+	umask(mask);
+
+	// no SA_RESTART: accept() must return to see 'stopping'
+	struct sigaction sa = {};
+	sa.sa_handler = stop;
+	sigaction(SIGTERM, &sa, nullptr);
+	sigaction(SIGINT, &sa, nullptr);
+	signal(SIGPIPE, SIG_IGN);
+
+	// the directories that changed are walked again
+	if (watch)
+		config.locate = false;
+	daemon_state state(config);
+	state.refresh(true);
+
+	int watch_fd = -1;
+#ifndef BUSTER
+	fs_watch watcher;
+	if (watch) {
+		// watching before the first scan, so that no change is missed
+		if (!watcher.start(config.root_dir))
+			return 1;
+		state.track();
+		watch_fd = watcher.fd();
+	}
+#endif
+
+	vector<client> clients;
+	while (!stopping) {
+		vector<struct pollfd> fds = {{listener, POLLIN, 0}, {watch_fd, POLLIN, 0}};
+		for (const auto& c: clients)
+			fds.push_back({c.fd, short((c.eof ? 0 : POLLIN) | (c.out.empty() ? 0 : POLLOUT)), 0});
+		// wake up now and then to drop the idle clients
+		if (poll(fds.data(), fds.size(), clients.empty() ? -1 : 1000) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+#ifndef BUSTER
+		if (fds[1].revents & POLLIN) {
+			vector<fs_change> changes;
+			if (!watcher.read(changes)) {
+				cerr << "fanotify queue overflow, scanning again\n";
+				state.rescan("/");
+			} else {
+				for (const auto& change: changes)
+					state.apply(change);
+			}
+		}
+#endif
+
+		time_t now = time(nullptr);
+		for (size_t i = 0; i < clients.size(); i++) {
+			auto& c = clients[i];
+			short events = fds[i + 2].revents;
+			bool keep;
+			if (events & (POLLIN | POLLHUP | POLLERR))
+				keep = serve(c, state);
+			else if (events & POLLOUT)
+				keep = flush(c);
+			else
+				keep = now - c.active < client_timeout;
+			if (events)
+				c.active = now;
+			if (!keep) {
+				close(c.fd);
+				c.fd = -1;
+			}
+		}
+		clients.erase(remove_if(clients.begin(), clients.end(), [](const client& c) { return c.fd < 0; }),
+		              clients.end());
+
+		if (!(fds[0].revents & POLLIN))
+			continue;
+		int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN)
+				continue;
+			perror("accept");
+			break;
+		}
+		clients.push_back({fd, "", "", false, now});
+	}
+	for (const auto& c: clients)
+		close(c.fd);
+	close(listener);
+	unlink(socket_path.c_str());
+	return 0;
+}
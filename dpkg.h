@@ -1,13 +1,18 @@
+#include <functional>
 #include <vector>
 #include <string>
 using namespace std;
 
+// receives each file of the installed packages with its package name, unsorted
+typedef function<void(string&&, const char*)> dpkg_sink;
+
 void dpkg_start( const string& root_dir);
 void dpkg_end();
 int query(const char *path);
 
 int read_dpkg_header(vector<string>& packages);
 int read_dpkg(vector<string>& packages, vector<string>& db, bool print_csv, const string& root_dir);
+int scan_dpkg(vector<string>& packages, const dpkg_sink& sink, bool print_csv, const string& root_dir);
 
 struct Diversion{
         string oldfile;
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <dirent.h>
 
+#include "counters.h"
 #include "dpkg_exclude.h"
 
 static int read_one_cfg(const string& filename, vector <string>& globs)
@@ -12,6 +13,7 @@ static int read_one_cfg(const string& filename, vector <string>& globs)
 	ifstream glob_file(filename);
 	for (string glob_line; getline(glob_file,glob_line);)
 	{
+		count_op(op_file_bytes, glob_line.size() + 1);
 		if (glob_line.find("path-exclude") != 0) continue;
 		glob_line = glob_line.substr(glob_line.find('/'));
                 // translate regular globs into cruft ones
@@ -28,6 +30,7 @@ int read_dpkg_excludes(vector<string>& excludes)
 
 	DIR *dp;
 	struct dirent *dirp;
+	count_op(op_opendir);
 	if((dp = opendir("/etc/dpkg/dpkg.cfg.d/")) == nullptr) {
 	      cerr << "Error(" << errno << ") opening /etc/dpkg/dpkg.cfg.d/" << endl;
 	      return 1;
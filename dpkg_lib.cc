@@ -17,6 +17,7 @@ extern "C" {
 #include <dpkg/pkg-show.h>
 }
 
+#include "counters.h"
 #include "dpkg.h"
 #include "usr_merge.h"
 
@@ -103,15 +104,16 @@ static const char *admindir;
 #ifdef DB_API
 #include <dpkg/db-ctrl.h>
 
-vector<string>* var_lib_dpkg_info = NULL;
+static const dpkg_sink* var_lib_dpkg_info = NULL;
+static const char* var_lib_dpkg_package = NULL;
 
 static void callback(const char *filename, const char *filetype)
 {
-	var_lib_dpkg_info->push_back(filename);
+	(*var_lib_dpkg_info)(filename, var_lib_dpkg_package);
 }
 #endif
 
-int read_dpkg(vector<string>& packages, vector<string>& output, bool print_csv, const string& root_dir)
+int scan_dpkg(vector<string>& packages, const dpkg_sink& output, bool print_csv, const string& root_dir)
 {
 	struct pkg_array array;
 	struct pkginfo *pkg;
@@ -161,6 +163,7 @@ int read_dpkg(vector<string>& packages, vector<string>& output, bool print_csv,
 #ifdef DB_API
 			// this is just too slow, from 2 seconds to 40
 			// I hope this will go away in the big DPKG rewrite
+			var_lib_dpkg_package = pkg->set->name;
 			pkg_infodb_foreach(pkg, &pkg->installed, callback);
 #else
 			string control_ = admindir;
@@ -176,8 +179,8 @@ int read_dpkg(vector<string>& packages, vector<string>& output, bool print_csv,
 
 			for (const auto& suffix: suffixes) {
 				string control = control_ + suffix;
-				if (stat(control.c_str(), &buffer) == 0) {
-					output.emplace_back(control.substr(root_dir_length));
+				if (counted_stat(control.c_str(), &buffer) == 0) {
+					output(control.substr(root_dir_length), pkg->set->name);
 				}
 			}
 #endif
@@ -187,25 +190,31 @@ int read_dpkg(vector<string>& packages, vector<string>& output, bool print_csv,
 				if (debug) cout << namenode->name << '\n';
 				if (namenode->divert) {
 					// We trust DPKG state for now
-					if (stat(namenode->name, &buffer) == 0) {
+					if (counted_stat(namenode->name, &buffer) == 0) {
 						string realname = usr_merge(namenode->name);
 						if (print_csv) csv(namenode->name, realname, pkg->set->name);
-						output.emplace_back(std::move(realname));
+						output(std::move(realname), pkg->set->name);
 					}
-					if (stat(namenode->divert->useinstead->name, &buffer) == 0) {
+					if (counted_stat(namenode->divert->useinstead->name, &buffer) == 0) {
 						string realname = usr_merge(namenode->divert->useinstead->name);
 						if (print_csv) csv(namenode->name, realname, pkg->set->name);
-						output.emplace_back(std::move(realname));
+						output(std::move(realname), pkg->set->name);
 					}
 				} else {
 					string realname = usr_merge(namenode->name);
 					if (print_csv) csv(namenode->name, realname, pkg->set->name);
-					output.emplace_back(std::move(realname));
+					output(std::move(realname), pkg->set->name);
 				}
 			}
 		}
 	}
 	pkg_array_destroy(&array);
+	return 0;
+}
+
+int read_dpkg(vector<string>& packages, vector<string>& output, bool print_csv, const string& root_dir)
+{
+	scan_dpkg(packages, [&output](string&& path, const char*) { output.emplace_back(std::move(path)); }, print_csv, root_dir);
 	sort(output.begin(), output.end());
 	output.erase( unique( output.begin(), output.end() ), output.end() );
 	return 0;
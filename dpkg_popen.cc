@@ -2,10 +2,12 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <iostream>
+#include <fstream>
 #include <algorithm>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <string.h>
+#include "counters.h"
 #include "dpkg.h"
 #include "usr_merge.h"
 
@@ -21,6 +23,7 @@ int query(const char *path)
 	char *pos;
 
 	sprintf(buf, "dpkg-query --search '%s' 2>/dev/null", path);
+	count_op(op_exec);
 	if ((fp = popen(buf, "r")) == NULL) return 0;
 	if (!fgets(buf, sizeof(buf), fp)) return 0;
 	pos = strchr(buf, ':');
@@ -37,12 +40,14 @@ int read_dpkg_header(vector<string>& packages)
 
 	if (debug) cerr << "DPKG DATA\n";
 	FILE* fp;
+	count_op(op_exec);
 	if ((fp = popen("dpkg-query --show --showformat '${Package}\n' | sort -u", "r")) == NULL) return 1;
 	const int SIZEBUF = 4096;
 	char buf[SIZEBUF];
 	string package;
 	while (fgets(buf, sizeof(buf),fp))
 	{
+		count_op(op_pipe_bytes, strlen(buf));
 		package=buf;
 		package=package.substr(0,package.size() - 1); // remove '/n'
 		//cerr << package << endl;
@@ -59,12 +64,14 @@ int read_diversions(vector<Diversion>& diversions)
 
 	FILE* fp;
         setenv("LANG", "C", 1);
+	count_op(op_exec);
 	if ((fp = popen("dpkg-divert --list", "r")) == NULL) return 1;
 
 	const int SIZEBUF = 4096;
 	char buf[SIZEBUF];
 	while (fgets(buf, sizeof(buf),fp))
 	{
+		count_op(op_pipe_bytes, strlen(buf));
 		const char* delim = " ";
 		bool local;
 		const char* LOCAL = "local";
@@ -108,6 +115,37 @@ int read_diversions(vector<Diversion>& diversions)
 	return 0;
 }
 
+// a line of a file list, with the diversions applied
+static void shipped_file(string filename, const vector<Diversion>& diversions, const function<void(string&&)>& output)
+{
+	struct stat stat_buffer;
+	for (const auto& diversion: diversions) {
+		if (filename==diversion.oldfile
+		    && counted_stat(filename.c_str(),&stat_buffer)!= 0) filename=diversion.newfile;
+	}
+
+	output(usr_merge(filename));
+
+	// also consider all intermediate subdirectories under /etc
+	if (filename.substr(0,5)!="/etc/")
+		return;
+
+	if (counted_stat(filename.c_str(),&stat_buffer) == 0)
+		if ((stat_buffer.st_mode & S_IFDIR) != 0)
+			return;
+
+	while (1)
+	{
+		size_t found;
+		found=filename.find_last_of("/");
+		filename=filename.substr(0,found);
+		if (filename == "/etc")
+			break;
+
+		output(string(filename));
+	}
+}
+
 static int read_dpkg_items(vector<string>& dpkg)
 {
 	bool debug=getenv("DEBUG") != NULL;
@@ -122,40 +160,15 @@ static int read_dpkg_items(vector<string>& dpkg)
 	const int SIZEBUF = 300;
 	char buf[SIZEBUF];
 	FILE* fp;
+	count_op(op_exec);
 	if ((fp = popen(command.c_str(), "r")) == NULL) return 1;
 	while (fgets(buf, sizeof(buf),fp))
 	{
+		count_op(op_pipe_bytes, strlen(buf));
 		string filename=buf;
 		if (filename.substr(0,1)!="/") continue;
 		filename=filename.substr(0,filename.size() - 1);
-		vector<Diversion>::iterator it=diversions.begin();
-		struct stat stat_buffer;
-		for(;it !=diversions.end();it++) {
-			if (filename==(*it).oldfile
-		            && stat(filename.c_str(),&stat_buffer)!= 0) filename=(*it).newfile;
-		}
-
-		dpkg.push_back(usr_merge(filename));
-
-
-		// also consider all intermediate subdirectories under /etc
-		if (filename.substr(0,5)!="/etc/")
-			continue;
-
-		if (stat(filename.c_str(),&stat_buffer) == 0)
-			if ((stat_buffer.st_mode & S_IFDIR) != 0)
-				continue;
-
-		while (1)
-		{
-			size_t found;
-			found=filename.find_last_of("/");
-			filename=filename.substr(0,found);
-			if (filename == "/etc")
-				break;
-
-			dpkg.push_back(filename);
-		}
+		shipped_file(filename, diversions, [&dpkg](string&& path) { dpkg.push_back(std::move(path)); });
 	}
         pclose(fp);
 	if (debug) cerr << "done"  << endl;
@@ -166,6 +179,48 @@ static int read_dpkg_items(vector<string>& dpkg)
 	return 0;
 }
 
+/* dpkg-query --listfiles does not tell which package ships a file,
+   so read the file list of each package as dpkg-query does:
+   /var/lib/dpkg/info/<binary:Package>.list */
+int scan_dpkg(vector<string>& packages, const dpkg_sink& output, bool csv, const string&)
+{
+	bool debug=getenv("DEBUG") != NULL;
+
+	read_dpkg_header(packages);
+	vector<Diversion> diversions;
+	read_diversions(diversions);
+
+	FILE* fp;
+	count_op(op_exec);
+	if ((fp = popen("dpkg-query --show --showformat '${binary:Package}\n'", "r")) == NULL) return 1;
+	const int SIZEBUF = 4096;
+	char buf[SIZEBUF];
+	while (fgets(buf, sizeof(buf),fp))
+	{
+		count_op(op_pipe_bytes, strlen(buf));
+		string binary=buf;
+		binary=binary.substr(0,binary.size() - 1); // remove '/n'
+		// "libc6:amd64" is in package "libc6"
+		string package=binary.substr(0, binary.find(':'));
+		ifstream list("/var/lib/dpkg/info/" + binary + ".list");
+		string filename;
+		while (getline(list, filename))
+		{
+			count_op(op_file_bytes, filename.size() + 1);
+			if (filename.substr(0,1)!="/") continue;
+			shipped_file(filename, diversions, [&](string&& path) { output(std::move(path), package.c_str()); });
+		}
+	}
+	pclose(fp);
+	if (debug) cerr << "done"  << endl;
+
+	// some more horrible hack for Buster backport
+	if (csv && system("/usr/lib/cruft/dpkg_csv.py") != 0)
+		cerr << "dpkg_csv.py failed" << endl;
+
+	return 0;
+}
+
 int read_dpkg(vector<string>& packages, vector<string>& files, bool csv, const string& root_dir) {
 	read_dpkg_header(packages);
 	read_dpkg_items(files);
@@ -0,0 +1,35 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <iostream>
+
+#include "columns.h"
+#include "output.h"
+
+using namespace std;
+
+// print binary exports from "cruft -x" or "cpigs -b" as .csv
+int main(int argc, char *argv[])
+{
+	if (argc < 2) {
+		cerr << "usage: cruft-dump FILE...\n";
+		return 1;
+	}
+
+	buffered_output out;
+	out << "path;package;type;verdict;size\n";
+	int rc = 0;
+	for (int i = 1; i < argc; i++) {
+		column_reader reader;
+		if (!reader.open(argv[i])) {
+			rc = 1;
+			continue;
+		}
+		column_row row;
+		while (reader.next(row)) {
+			out << row.path << ';' << row.package << ';' << row.type << ';'
+			    << verdict_name(row.verdict) << ';' << row.size << '\n';
+		}
+	}
+	return rc;
+}
@@ -0,0 +1,155 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "estimate.h"
+
+using namespace std;
+
+double estimate_figure::margin() const
+{
+	return 1.96 * sqrt(variance);
+}
+
+// "/var/lib/foo" is in "/var", "/" is its own section
+static string top_of(const string& dir)
+{
+	return dir == "/" ? dir : dir.substr(0, dir.find('/', 1));
+}
+
+tree_sample::tree_sample(const tree_lister& list, size_t walks, unsigned seed)
+{
+	auto list_once = [&](const string& dir) -> const listing& {
+		auto found = listings.find(dir);
+		if (found == listings.end()) {
+			found = listings.emplace(dir, listing()).first;
+			list(dir, found->second.entries, found->second.subdirs);
+		}
+		return found->second;
+	};
+
+	// the shallow directories in full, breadth first
+	vector<string> level = {"/"};
+	for (int depth = 0; depth <= estimate_exact_depth; depth++) {
+		vector<string> next;
+		for (const auto& dir: level) {
+			exact.push_back(dir);
+			const auto& l = list_once(dir);
+			if (depth < estimate_exact_depth)
+				next.insert(next.end(), l.subdirs.begin(), l.subdirs.end());
+			else if (!l.subdirs.empty())
+				strata.push_back({dir, {}});
+		}
+		level = std::move(next);
+	}
+
+	// at least two walks per stratum for a variance, the others by size
+	size_t subdirs = 0;
+	for (const auto& s: strata)
+		subdirs += listings[s.dir].subdirs.size();
+	mt19937 random(seed);
+	for (auto& s: strata) {
+		size_t n = max<size_t>(2, lround(double(walks) * listings[s.dir].subdirs.size() / subdirs));
+		s.walks.resize(n);
+		for (auto& walk: s.walks) {
+			string dir = s.dir;
+			double weight = 1;
+			for (;;) {
+				const auto& below = listings[dir].subdirs;
+				if (below.empty())
+					break;
+				weight *= below.size();
+				dir = below[uniform_int_distribution<size_t>(0, below.size() - 1)(random)];
+				list_once(dir);
+				walk.emplace_back(dir, weight);
+			}
+		}
+	}
+}
+
+vector<string> tree_sample::paths() const
+{
+	vector<string> all;
+	for (const auto& l: listings)
+		all.insert(all.end(), l.second.entries.begin(), l.second.entries.end());
+	sort(all.begin(), all.end());
+	all.erase(unique(all.begin(), all.end()), all.end());
+	return all;
+}
+
+size_t tree_sample::walks() const
+{
+	size_t n = 0;
+	for (const auto& s: strata)
+		n += s.walks.size();
+	return n;
+}
+
+void tree_sample::estimate(const vector<string>& unexplained, const function<uint64_t(const string&)>& size,
+                           vector<estimate_totals>& totals) const
+{
+	// what each listed directory holds
+	struct counted { double entries = 0, unexplained = 0, bytes = 0; };
+	map<string, counted> dirs;
+	for (const auto& l: listings) {
+		auto& c = dirs[l.first];
+		c.entries = l.second.entries.size();
+		for (const auto& entry: l.second.entries) {
+			if (!binary_search(unexplained.begin(), unexplained.end(), entry))
+				continue;
+			c.unexplained++;
+			c.bytes += size(entry);
+		}
+	}
+
+	map<string, estimate_totals> sections;
+	for (const auto& dir: exact) {
+		const auto& c = dirs[dir];
+		auto& t = sections[top_of(dir)];
+		t.entries.value += c.entries;
+		t.unexplained.value += c.unexplained;
+		t.bytes.value += c.bytes;
+	}
+
+	// the mean of the walks and the variance of that mean
+	for (const auto& s: strata) {
+		vector<counted> sums(s.walks.size());
+		for (size_t i = 0; i < s.walks.size(); i++) {
+			for (const auto& step: s.walks[i]) {
+				const auto& c = dirs[step.first];
+				sums[i].entries += step.second * c.entries;
+				sums[i].unexplained += step.second * c.unexplained;
+				sums[i].bytes += step.second * c.bytes;
+			}
+		}
+		auto add = [&sums](estimate_figure& figure, double counted::*field) {
+			double n = sums.size(), mean = 0, squares = 0;
+			for (const auto& sum: sums)
+				mean += sum.*field / n;
+			for (const auto& sum: sums)
+				squares += (sum.*field - mean) * (sum.*field - mean);
+			figure.value += mean;
+			figure.variance += squares / (n - 1) / n;
+		};
+		auto& t = sections[top_of(s.dir)];
+		add(t.entries, &counted::entries);
+		add(t.unexplained, &counted::unexplained);
+		add(t.bytes, &counted::bytes);
+	}
+
+	// the strata are independent, their variances add up
+	estimate_totals total;
+	total.section = "total";
+	for (auto& section: sections) {
+		section.second.section = section.first;
+		for (auto figure: {&estimate_totals::entries, &estimate_totals::unexplained, &estimate_totals::bytes}) {
+			(total.*figure).value += (section.second.*figure).value;
+			(total.*figure).variance += (section.second.*figure).variance;
+		}
+		totals.push_back(section.second);
+	}
+	totals.push_back(total);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+/* --estimate: the unexplained files and bytes of a tree from a sample
+   of its directories instead of a full scan
+
+   the directories down to 'estimate_exact_depth' are all listed, each
+   of the deepest of them is a stratum below which random walks go down
+   one subdirectory at a time; what a walk lists is weighted by the
+   product of the number of subdirectories it chose among, which makes
+   it an unbiased estimate of the whole stratum (Knuth's estimator).
+   The walks are shared among the strata by their number of
+   subdirectories, the spread of the walks of a stratum gives its
+   variance */
+
+// a directory: the entries the scan reports, and the subdirectories it walks into
+typedef std::function<void(const std::string& dir, std::vector<std::string>& entries, std::vector<std::string>& subdirs)> tree_lister;
+
+// "/" is depth 0, "/usr" 1, "/usr/share" 2
+static const int estimate_exact_depth = 2;
+
+struct estimate_figure
+{
+	double value = 0;
+	double variance = 0;
+	// half the width of the 95% confidence interval, with the normal approximation
+	double margin() const;
+};
+
+struct estimate_totals
+{
+	std::string section;            // a top-level directory, "/" for the root itself, or "total"
+	estimate_figure entries;        // what a full scan would report
+	estimate_figure unexplained;
+	estimate_figure bytes;          // of the unexplained entries
+};
+
+class tree_sample
+{
+public:
+	// 'walks' random walks below the part listed in full
+	tree_sample(const tree_lister& list, size_t walks, unsigned seed);
+
+	// every listed entry, sorted, to go through the pipeline
+	std::vector<std::string> paths() const;
+	size_t listed() const { return listings.size(); }
+	size_t walks() const;
+
+	/* 'unexplained' is sorted, 'size' gives the bytes of an unexplained entry;
+	   one section per top-level directory, then the total */
+	void estimate(const std::vector<std::string>& unexplained, const std::function<uint64_t(const std::string&)>& size,
+	              std::vector<estimate_totals>& totals) const;
+
+private:
+	struct listing
+	{
+		std::vector<std::string> entries;
+		std::vector<std::string> subdirs;
+	};
+	// each directory is listed once, however many walks go through it
+	std::map<std::string, listing> listings;
+	// the directories listed in full
+	std::vector<std::string> exact;
+	struct stratum
+	{
+		std::string dir;
+		// per walk, the directories listed and their weight
+		std::vector<std::vector<std::pair<std::string, double>>> walks;
+	};
+	std::vector<stratum> strata;
+};
@@ -5,22 +5,30 @@
 #include <iostream>
 #include <algorithm>
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 
+#include "counters.h"
 #include "explain.h"
+#include "progress.h"
 #include "usr_merge.h"
 #include "owner.h"
 
-static void read_one_explain(const string& script, const string& package, vector<owner>& explain)
+void run_explain(const string& script, const string& package, vector<owner>& explain)
 {
 	int fd[2];
-	if (pipe(fd) != 0) {
+	// close-on-exec: other threads may be forking at the same time
+	if (pipe2(fd, O_CLOEXEC) != 0) {
 		perror("pipe");
 		exit(1);
 	}
-	if(!fork()) // child
+	count_op(op_exec);
+	progress_where(script);
+	pid_t pid = fork();
+	if(!pid) // child
 	{
 		dup2(fd[1], STDOUT_FILENO);
 		close(fd[0]);
@@ -38,6 +46,7 @@ static void read_one_explain(const string& script, const string& package, vector
 	string real_package = package;
 	while (fgets(buf, sizeof(buf),fp))
 	{
+		count_op(op_pipe_bytes, strlen(buf));
 		filter=buf;
 		filter=filter.substr(0,filter.size() - 1); // remove '/n'
 		if (filter.front() == '/') {
@@ -47,15 +56,18 @@ static void read_one_explain(const string& script, const string& package, vector
 		}
 	}
 	fclose(fp);
+	// long-lived users like cruft-daemon would pile up zombies
+	waitpid(pid, nullptr, 0);
 }
 
-static void read_uppercase(vector<owner>& explain, const string& directory, bool debug)
+static void list_uppercase(vector<owner>& scripts, const string& directory, bool debug)
 {
 	DIR *dp;
 	struct dirent *dirp;
 
 	if (debug) cerr << "EXECUTING UPPERCASE FILTERS IN " << directory  << endl;
 
+	count_op(op_opendir);
 	if((dp = opendir(directory.c_str())) == nullptr) {
 		cerr << "Failed to open directory " << directory << ": " << strerror(errno) << endl;
 		return;
@@ -65,29 +77,58 @@ static void read_uppercase(vector<owner>& explain, const string& directory, bool
 		if (package==".") continue;
 		if (package=="..") continue;
 		if (!any_of(package.begin(), package.end(), [] (unsigned char c) { return islower(c); }))
-			read_one_explain(directory + package, package, explain);
+			scripts.emplace_back(package, directory + package);
 	}
 	closedir(dp);
 	if (debug) cerr << endl;
 }
 
-int read_explain(const string& dir, const vector<string>& packages, vector<owner>& explain)
+void list_explain_uppercase(const string& dir, vector<owner>& scripts)
 {
 	bool debug=getenv("DEBUG") != nullptr;
 
-	read_uppercase(explain, "/usr/libexec/cruft/", debug);
-	read_uppercase(explain, dir, debug);
+	list_uppercase(scripts, "/usr/libexec/cruft/", debug);
+	list_uppercase(scripts, dir, debug);
+}
 
-	if (debug) cerr << "EXECUTING OTHER FILTERS" << endl;
+void list_explain_packages(const string& dir, const vector<string>& packages, vector<owner>& scripts)
+{
 	for (const auto& package: packages) {
 		struct stat stat_buffer;
 		string etc_filename = dir + package;
 		string usr_filename = "/usr/libexec/cruft/" + package;
-		if ( stat(etc_filename.c_str(), &stat_buffer)==0 )
-			read_one_explain(etc_filename, package, explain);
-		else if ( stat(usr_filename.c_str(), &stat_buffer)==0 )
-			read_one_explain(usr_filename, package, explain);
+		if ( counted_stat(etc_filename.c_str(), &stat_buffer)==0 )
+			scripts.emplace_back(package, etc_filename);
+		else if ( counted_stat(usr_filename.c_str(), &stat_buffer)==0 )
+			scripts.emplace_back(package, usr_filename);
 	}
+}
+
+int read_explain_uppercase(const string& dir, vector<owner>& explain)
+{
+	vector<owner> scripts;
+	list_explain_uppercase(dir, scripts);
+	for (const auto& script: scripts)
+		run_explain(script.path, script.package, explain);
+	return 0;
+}
+
+int read_explain_packages(const string& dir, const vector<string>& packages, vector<owner>& explain)
+{
+	bool debug=getenv("DEBUG") != nullptr;
+
+	if (debug) cerr << "EXECUTING OTHER FILTERS" << endl;
+	vector<owner> scripts;
+	list_explain_packages(dir, packages, scripts);
+	for (const auto& script: scripts)
+		run_explain(script.path, script.package, explain);
+	return 0;
+}
+
+int read_explain(const string& dir, const vector<string>& packages, vector<owner>& explain)
+{
+	read_explain_uppercase(dir, explain);
+	read_explain_packages(dir, packages, explain);
 	sort(explain.begin(), explain.end());
 	explain.erase( unique( explain.begin(), explain.end() ), explain.end() );
 	return 0;
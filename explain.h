@@ -2,4 +2,11 @@
 #include <string>
 #include "owner.h"
 
+// the scripts that read_explain_uppercase() and read_explain_packages() run, as (package, script)
+void list_explain_uppercase(const std::string& dir, std::vector<owner>& scripts);
+void list_explain_packages(const std::string& dir, const std::vector<std::string>& packages, std::vector<owner>& scripts);
+void run_explain(const std::string& script, const std::string& package, std::vector<owner>& explain);
+
+int read_explain_uppercase(const std::string& dir, std::vector<owner>& explain);
+int read_explain_packages(const std::string& dir, const std::vector<std::string>& packages, std::vector<owner>& explain);
 int read_explain(const std::string& dir, const std::vector<std::string>& packages, std::vector<owner>& explain);
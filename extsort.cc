@@ -0,0 +1,226 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+#include "extsort.h"
+
+using namespace std;
+
+static const size_t fan_in = 64;
+
+external_sorter::external_sorter(size_t max_bytes_) : max_bytes(max_bytes_)
+{
+}
+
+external_sorter::~external_sorter()
+{
+	for (auto fp: files)
+		fclose(fp);
+	for (const auto& level: levels)
+		for (auto fp: level)
+			fclose(fp);
+}
+
+void external_sorter::add(string&& path)
+{
+	bytes += sizeof(string) + path.capacity();
+	buffer.emplace_back(std::move(path));
+	if (bytes >= max_bytes)
+		spill();
+}
+
+static void write_varint(size_t value, FILE* fp)
+{
+	while (value >= 0x80) {
+		putc_unlocked((value & 0x7f) | 0x80, fp);
+		value >>= 7;
+	}
+	putc_unlocked(value, fp);
+}
+
+static bool read_varint(size_t& value, FILE* fp)
+{
+	value = 0;
+	for (int shift = 0;; shift += 7) {
+		int c = getc_unlocked(fp);
+		if (c == EOF) return false;
+		value |= size_t(c & 0x7f) << shift;
+		if (!(c & 0x80)) return true;
+	}
+}
+
+static FILE* create_run()
+{
+	const char* tmpdir = getenv("TMPDIR");
+	string name = string(tmpdir ? tmpdir : "/tmp") + "/cruft-XXXXXX";
+	int fd = mkstemp(&name[0]);
+	FILE* fp = fd < 0 ? nullptr : fdopen(fd, "w+");
+	if (fp == nullptr) {
+		cerr << "Failed to create temporary file " << name << ": " << strerror(errno) << '\n';
+		exit(1);
+	}
+	unlink(name.c_str());
+	return fp;
+}
+
+// each record is: length shared with the previous path, length of the rest, the rest
+static void write_record(FILE* fp, const string* prev, const string& path)
+{
+	size_t shared = 0;
+	if (prev) {
+		size_t max = min(prev->size(), path.size());
+		while (shared < max && (*prev)[shared] == path[shared]) shared++;
+	}
+	write_varint(shared, fp);
+	write_varint(path.size() - shared, fp);
+	fwrite(path.data() + shared, 1, path.size() - shared, fp);
+}
+
+static void close_run(FILE* fp)
+{
+	if (fflush(fp) != 0) {
+		cerr << "Failed to write temporary file: " << strerror(errno) << '\n';
+		exit(1);
+	}
+}
+
+void external_sorter::spill()
+{
+	sort(buffer.begin(), buffer.end());
+
+	FILE* fp = create_run();
+	const string* prev = nullptr;
+	for (const auto& path: buffer) {
+		if (prev && *prev == path) continue;
+		write_record(fp, prev, path);
+		prev = &path;
+	}
+	close_run(fp);
+	spilled++;
+	add_run(fp, 0);
+
+	buffer.clear();
+	buffer.shrink_to_fit();
+	bytes = 0;
+}
+
+void external_sorter::add_run(FILE* run, size_t level)
+{
+	if (levels.size() <= level)
+		levels.resize(level + 1);
+	levels[level].push_back(run);
+	if (levels[level].size() < fan_in)
+		return;
+
+	files.swap(levels[level]);
+	start_merge();
+	FILE* merged = create_run();
+	string path, prev;
+	for (bool first = true; merge_next(path); first = false) {
+		write_record(merged, first ? nullptr : &prev, path);
+		prev.swap(path);
+	}
+	close_run(merged);
+	for (auto fp: files)
+		fclose(fp);
+	files.clear();
+	add_run(merged, level + 1);
+}
+
+bool external_sorter::read_run(size_t i)
+{
+	size_t shared, rest;
+	if (!read_varint(shared, files[i]) || !read_varint(rest, files[i]))
+		return false;
+	heads[i].resize(shared + rest);
+	if (fread(&heads[i][shared], 1, rest, files[i]) != rest) {
+		cerr << "Failed to read temporary file\n";
+		exit(1);
+	}
+	return true;
+}
+
+void external_sorter::sift_down(size_t pos)
+{
+	for (;;) {
+		size_t smallest = pos, l = 2 * pos + 1, r = l + 1;
+		if (l < heap.size() && heads[heap[l]] < heads[heap[smallest]]) smallest = l;
+		if (r < heap.size() && heads[heap[r]] < heads[heap[smallest]]) smallest = r;
+		if (smallest == pos) return;
+		swap(heap[pos], heap[smallest]);
+		pos = smallest;
+	}
+}
+
+// the k-way merge of 'files', from their start
+void external_sorter::start_merge()
+{
+	heads.assign(files.size(), string());
+	heap.clear();
+	first = true;
+	for (size_t i = 0; i < files.size(); i++) {
+		rewind(files[i]);
+		if (read_run(i))
+			heap.push_back(i);
+	}
+	for (size_t i = heap.size(); i-- > 0;)
+		sift_down(i);
+}
+
+bool external_sorter::merge_next(string& path)
+{
+	while (!heap.empty()) {
+		size_t i = heap.front();
+		bool duplicate = !first && heads[i] == last;
+		if (!duplicate) {
+			last = heads[i];
+			first = false;
+		}
+		if (read_run(i)) {
+			sift_down(0);
+		} else {
+			heap.front() = heap.back();
+			heap.pop_back();
+			if (!heap.empty()) sift_down(0);
+		}
+		if (!duplicate) {
+			path = last;
+			return true;
+		}
+	}
+	return false;
+}
+
+void external_sorter::finish()
+{
+	// everything fits in memory: no need to touch the disk
+	if (spilled == 0) {
+		sort(buffer.begin(), buffer.end());
+		buffer.erase( unique( buffer.begin(), buffer.end() ), buffer.end() );
+		return;
+	}
+
+	if (!buffer.empty())
+		spill();
+
+	// at most fan_in - 1 runs per level are left
+	for (auto& level: levels)
+		files.insert(files.end(), level.begin(), level.end());
+	levels.clear();
+	start_merge();
+}
+
+bool external_sorter::next(string& path)
+{
+	if (spilled == 0) {
+		if (buffer_pos == buffer.size())
+			return false;
+		path = std::move(buffer[buffer_pos++]);
+		return true;
+	}
+	return merge_next(path);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/* sorts more paths than fit in memory:
+   once 'max_bytes' are buffered, the buffer is sorted and spilled
+   to a temporary file as a front-coded run; runs are merged 'fan_in'
+   at a time into bigger ones as they come, so that few files are open
+   however small 'max_bytes' is; finish() then k-way merges what is
+   left, dropping duplicates like sort + unique would */
+class external_sorter
+{
+public:
+	explicit external_sorter(size_t max_bytes);
+	~external_sorter();
+	external_sorter(const external_sorter&) = delete;
+	external_sorter& operator=(const external_sorter&) = delete;
+
+	void add(std::string&& path);
+	void finish();
+	// next path in sorted order, false at the end
+	bool next(std::string& path);
+	// the runs spilled, merged or not
+	size_t runs() const { return spilled; }
+
+private:
+	void spill();
+	void add_run(FILE* run, size_t level);
+	void start_merge();
+	bool merge_next(std::string& path);
+	bool read_run(size_t i);
+	void sift_down(size_t pos);
+
+	size_t max_bytes;
+	size_t bytes = 0;
+	std::vector<std::string> buffer;
+	size_t buffer_pos = 0;
+	size_t spilled = 0;
+
+	// runs waiting to be merged, by level; level n+1 runs come from fan_in level n ones
+	std::vector<std::vector<FILE*>> levels;
+	// the runs being merged
+	std::vector<FILE*> files;
+	std::vector<std::string> heads;
+	std::vector<size_t> heap; // indices into 'heads', smallest first
+	std::string last;
+	bool first = true;
+};
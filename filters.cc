@@ -8,6 +8,7 @@
 #include <sys/stat.h>
 #include <dirent.h>
 
+#include "counters.h"
 #include "filters.h"
 #include "usr_merge.h"
 
@@ -17,6 +18,7 @@ static void read_one_filter(const string& glob_filename, const string& package,
 	ifstream glob_file(glob_filename);
 	for (string glob_line; getline(glob_file, glob_line);)
 	{
+		count_op(op_file_bytes, glob_line.size() + 1);
 		if (glob_line.empty()) continue;
 		if (glob_line.front() == '#') continue;
 		if (glob_line.front() == '/') {
@@ -33,6 +35,7 @@ int read_filters(const string& dir, const string& ruleset_file, const vector<str
 	if (debug) cerr << "READING UPPERCASE GLOBS IN " << dir << endl;
 	DIR *dp;
 	struct dirent *dirp;
+	count_op(op_opendir);
 	if((dp = opendir(dir.c_str())) == nullptr) {
 	      cerr << "Failed to open filters directory " << dir << ": " << strerror(errno) << endl;
 	      exit(1);
@@ -54,11 +57,11 @@ int read_filters(const string& dir, const string& ruleset_file, const vector<str
 		string etc_filename = dir + package;
 		string usr_filename = "/usr/lib/cruft/filters-unex/" + package;
 		string usr_filename_new = "/usr/share/cruft/rules/" + package;
-		if ( stat(etc_filename.c_str(), &stat_buffer)==0 )
+		if ( counted_stat(etc_filename.c_str(), &stat_buffer)==0 )
 			read_one_filter(etc_filename, package, globs, debug);
-		else if ( stat(usr_filename.c_str(), &stat_buffer)==0 )
+		else if ( counted_stat(usr_filename.c_str(), &stat_buffer)==0 )
 			read_one_filter(usr_filename, package, globs, debug);
-		else if ( stat(usr_filename_new.c_str(), &stat_buffer)==0 )
+		else if ( counted_stat(usr_filename_new.c_str(), &stat_buffer)==0 )
 			read_one_filter(usr_filename_new, package, globs, debug);
 	}
 	if (debug) cerr << globs.size() << " globs in database" << endl << endl;
@@ -69,6 +72,7 @@ int read_filters(const string& dir, const string& ruleset_file, const vector<str
 	string package;
 	for (string glob_line; getline(glob_file, glob_line);)
 	{
+		count_op(op_file_bytes, glob_line.size() + 1);
 		if (glob_line.empty())
 			continue;
 		if (glob_line.front() == '#')
@@ -82,7 +86,7 @@ int read_filters(const string& dir, const string& ruleset_file, const vector<str
 			package = glob_line;
 			string etc_filename = dir + package;
 			struct stat stat_buffer;
-			keep = find(packages.begin(), packages.end(), package) != packages.end() && stat(etc_filename.c_str(), &stat_buffer)!=0;
+			keep = find(packages.begin(), packages.end(), package) != packages.end() && counted_stat(etc_filename.c_str(), &stat_buffer)!=0;
 			//cerr << package << " " << keep << endl;
 		}
 	}
@@ -93,3 +97,27 @@ int read_filters(const string& dir, const string& ruleset_file, const vector<str
 	if (debug) cerr << globs.size() << " globs in database" << endl << endl;
 	return 0;
 }
+
+int read_ruleset(const string& ruleset_file, vector<owner>& globs)
+{
+	ifstream glob_file(ruleset_file);
+	if (!glob_file) {
+		cerr << "Failed to open ruleset " << ruleset_file << ": " << strerror(errno) << '\n';
+		return 1;
+	}
+	string package;
+	for (string glob_line; getline(glob_file, glob_line);)
+	{
+		count_op(op_file_bytes, glob_line.size() + 1);
+		if (glob_line.empty() || glob_line.front() == '#')
+			continue;
+		if (glob_line.front() == '/')
+			globs.emplace_back(package, usr_merge(glob_line));
+		else
+			package = glob_line;
+	}
+
+	sort(globs.begin(), globs.end());
+	globs.erase( unique( globs.begin(), globs.end() ), globs.end() );
+	return 0;
+}
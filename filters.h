@@ -4,3 +4,5 @@
 #include "owner.h"
 
 int read_filters(const std::string& dir, const std::string& ruleset_file, const std::vector<std::string>& packages, std::vector<owner>& globs);
+// every rule of the ruleset file, whatever is installed
+int read_ruleset(const std::string& ruleset_file, std::vector<owner>& globs);
@@ -0,0 +1,388 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "columns.h"
+#include "filters.h"
+#include "output.h"
+#include "shellexp.h"
+
+using namespace std;
+
+/* merges the unexplained paths of many cruft reports, one per host:
+   each report is sorted into a run on disk, runs are merged 'fan_in'
+   at a time into bigger ones, so memory only depends on the largest
+   report and on 'fan_in', not on the number of reports */
+
+static const size_t fan_in = 64;
+
+struct entry
+{
+	string path;
+	uint64_t hosts;
+	uint64_t bytes;
+};
+
+static void write_varint(uint64_t value, FILE* fp)
+{
+	while (value >= 0x80) {
+		putc_unlocked((value & 0x7f) | 0x80, fp);
+		value >>= 7;
+	}
+	putc_unlocked(value, fp);
+}
+
+static bool read_varint(uint64_t& value, FILE* fp)
+{
+	value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = getc_unlocked(fp);
+		if (c == EOF) return false;
+		value |= uint64_t(c & 0x7f) << shift;
+		if (!(c & 0x80)) return true;
+	}
+	return false;
+}
+
+// a run is a temporary file of front-coded entries sorted by path
+class run_writer
+{
+public:
+	run_writer()
+	{
+		const char* tmpdir = getenv("TMPDIR");
+		string name = string(tmpdir ? tmpdir : "/tmp") + "/cruft-fleet-XXXXXX";
+		int fd = mkstemp(&name[0]);
+		fp = fd < 0 ? nullptr : fdopen(fd, "w+");
+		if (fp == nullptr) {
+			cerr << "Failed to create temporary file " << name << ": " << strerror(errno) << '\n';
+			exit(1);
+		}
+		unlink(name.c_str());
+	}
+
+	void add(const entry& e)
+	{
+		size_t shared = 0;
+		size_t max = min(last.size(), e.path.size());
+		while (shared < max && last[shared] == e.path[shared]) shared++;
+		write_varint(shared, fp);
+		write_varint(e.path.size() - shared, fp);
+		fwrite(e.path.data() + shared, 1, e.path.size() - shared, fp);
+		write_varint(e.hosts, fp);
+		write_varint(e.bytes, fp);
+		last = e.path;
+	}
+
+	// the finished run, rewound for reading
+	FILE* finish()
+	{
+		if (fflush(fp) != 0) {
+			cerr << "Failed to write temporary file: " << strerror(errno) << '\n';
+			exit(1);
+		}
+		rewind(fp);
+		return fp;
+	}
+
+private:
+	FILE* fp;
+	string last;
+};
+
+static bool read_entry(FILE* fp, entry& e)
+{
+	uint64_t shared, rest;
+	if (!read_varint(shared, fp) || !read_varint(rest, fp))
+		return false;
+	if (shared > e.path.size()) {
+		cerr << "Corrupted temporary file\n";
+		exit(1);
+	}
+	e.path.resize(shared + rest);
+	if (fread(&e.path[shared], 1, rest, fp) != rest
+	    || !read_varint(e.hosts, fp) || !read_varint(e.bytes, fp)) {
+		cerr << "Failed to read temporary file\n";
+		exit(1);
+	}
+	return true;
+}
+
+// k-way merge of 'runs', adding up the entries of a same path
+static void merge_runs(vector<FILE*>& runs, const function<void(const entry&)>& output)
+{
+	vector<entry> heads(runs.size());
+	vector<size_t> heap;
+	for (size_t i = 0; i < runs.size(); i++)
+		if (read_entry(runs[i], heads[i]))
+			heap.push_back(i);
+	auto greater = [&heads](size_t a, size_t b) { return heads[a].path > heads[b].path; };
+	make_heap(heap.begin(), heap.end(), greater);
+
+	entry merged;
+	bool pending = false;
+	while (!heap.empty()) {
+		pop_heap(heap.begin(), heap.end(), greater);
+		size_t i = heap.back();
+		if (pending && merged.path == heads[i].path) {
+			merged.hosts += heads[i].hosts;
+			merged.bytes += heads[i].bytes;
+		} else {
+			if (pending) output(merged);
+			merged = heads[i];
+			pending = true;
+		}
+		if (read_entry(runs[i], heads[i]))
+			push_heap(heap.begin(), heap.end(), greater);
+		else
+			heap.pop_back();
+	}
+	if (pending) output(merged);
+
+	for (auto fp: runs)
+		fclose(fp);
+	runs.clear();
+}
+
+// runs waiting to be merged, by level; level n+1 runs come from fan_in level n ones
+static vector<vector<FILE*>> levels;
+
+static void add_run(FILE* run, size_t level = 0)
+{
+	if (levels.size() <= level)
+		levels.resize(level + 1);
+	levels[level].push_back(run);
+	if (levels[level].size() < fan_in)
+		return;
+	run_writer merged;
+	merge_runs(levels[level], [&merged](const entry& e) { merged.add(e); });
+	add_run(merged.finish(), level + 1);
+}
+
+/* the few fields of the flat objects written one per line
+   by "cruft --format=ndjson" and "cruft --format=json" */
+static bool json_field(const string& line, const char* key, string& value)
+{
+	string pattern = string("\"") + key + "\":";
+	size_t pos = line.find(pattern);
+	if (pos == string::npos)
+		return false;
+	pos += pattern.size();
+	value.clear();
+	if (pos >= line.size() || line[pos] != '"') {
+		while (pos < line.size() && isdigit(static_cast<unsigned char>(line[pos])))
+			value += line[pos++];
+		return true;
+	}
+	for (pos++; pos < line.size() && line[pos] != '"'; pos++) {
+		if (line[pos] != '\\') {
+			value += line[pos];
+			continue;
+		}
+		if (++pos >= line.size())
+			break;
+		switch (line[pos]) {
+		case 'n': value += '\n'; break;
+		case 't': value += '\t'; break;
+		case 'u':
+			// \u00XX for control characters, \udcXX for the bytes of no UTF-8 character
+			value += char(strtol(line.substr(pos + 1, 4).c_str(), nullptr, 16) & 0xff);
+			pos += 4;
+			break;
+		default: value += line[pos];
+		}
+	}
+	return true;
+}
+
+static void read_json(istream& in, vector<entry>& entries)
+{
+	string type, section, path, bytes;
+	for (string line; getline(in, line);) {
+		if (json_field(line, "type", type)) {
+			// a JSON section header, or an NDJSON entry
+			if (line.find("\"entries\":[") != string::npos) {
+				section = type;
+				continue;
+			}
+		} else if (line.compare(0, 9, "{\"path\":\"") == 0) {
+			type = section;
+		} else {
+			continue;
+		}
+		if (type != "unexplained" || !json_field(line, "path", path))
+			continue;
+		uint64_t size = json_field(line, "bytes", bytes) ? strtoull(bytes.c_str(), nullptr, 10) : 0;
+		entries.push_back({path, 1, size});
+	}
+}
+
+/* the "        path" lines of the unexplained sections,
+   without the bug and --collapse annotations */
+static void read_text(istream& in, vector<entry>& entries)
+{
+	bool unexplained = false;
+	for (string line; getline(in, line);) {
+		if (line.compare(0, 5, "---- ") == 0) {
+			unexplained = line.compare(0, 18, "---- unexplained: ") == 0;
+			continue;
+		}
+		if (!unexplained || line.compare(0, 8, "        ") != 0)
+			continue;
+		string path = line.substr(8);
+		uint64_t bytes = 0;
+		size_t bug = path.rfind("       (Bug: #");
+		if (bug != string::npos)
+			path.resize(bug);
+		size_t folded = path.rfind("/**       (");
+		if (folded != string::npos) {
+			size_t comma = path.find(" entries, ", folded);
+			if (comma != string::npos)
+				bytes = strtoull(path.c_str() + comma + 10, nullptr, 10);
+			path.resize(folded);
+		}
+		entries.push_back({path, 1, bytes});
+	}
+}
+
+static bool read_report(const string& file, vector<entry>& entries)
+{
+	ifstream in(file, ios::binary);
+	if (!in) {
+		cerr << "cannot open " << file << ": " << strerror(errno) << '\n';
+		return false;
+	}
+	char magic[8] = {};
+	in.read(magic, sizeof(magic));
+	if (in.gcount() == sizeof(magic) && memcmp(magic, "CRUFTCOL", sizeof(magic)) == 0) {
+		column_reader reader;
+		if (!reader.open(file))
+			return false;
+		column_row row;
+		while (reader.next(row))
+			if (row.verdict == verdict_unexplained)
+				entries.push_back({row.path, 1, row.size});
+		return true;
+	}
+
+	in.clear();
+	in.seekg(0);
+	if (magic[0] == '{')
+		read_json(in, entries);
+	else
+		read_text(in, entries);
+	return true;
+}
+
+static void usage()
+{
+	cerr << "usage: cruft-fleet [-t PERCENT] [-R RULESET] [-l LIST] [REPORT...]\n\n";
+	cerr << "merge the cruft reports of many hosts (text, ndjson or binary export)\n";
+	cerr << "and print how many hosts have each unexplained path\n\n";
+	cerr << "    -t --threshold   only print paths found on at least PERCENT % of hosts\n";
+	cerr << "    -R --ruleset     guess packages from this ruleset (default: /usr/share/cruft/ruleset)\n";
+	cerr << "    -l --list        read report file names from this file, one per line\n";
+}
+
+int main(int argc, char *argv[])
+{
+	double threshold = 0;
+	string ruleset_file = "/usr/share/cruft/ruleset";
+	vector<string> reports;
+
+	const struct option long_options[] =
+	{
+		{"help", no_argument, nullptr, 'h'},
+		{"threshold", required_argument, nullptr, 't'},
+		{"ruleset", required_argument, nullptr, 'R'},
+		{"list", required_argument, nullptr, 'l'},
+		{0, 0, 0, 0}
+	};
+
+	int opt, opti = 0;
+	while ((opt = getopt_long(argc, argv, "ht:R:l:", long_options, &opti)) != EOF) {
+		switch (opt) {
+		case 't':
+			try {
+				threshold = stod(optarg);
+			} catch(...) {
+				usage();
+				return 1;
+			}
+			break;
+		case 'R':
+			ruleset_file = optarg;
+			break;
+		case 'l': {
+			ifstream list(optarg);
+			if (!list) {
+				cerr << "cannot open " << optarg << ": " << strerror(errno) << '\n';
+				return 1;
+			}
+			for (string line; getline(list, line);)
+				if (!line.empty()) reports.push_back(line);
+			break;
+		}
+		case 'h':
+			usage();
+			return 0;
+		default:
+			usage();
+			return 1;
+		}
+	}
+	for (int i = optind; i < argc; i++)
+		reports.emplace_back(argv[i]);
+	if (reports.empty()) {
+		usage();
+		return 1;
+	}
+
+	// without a ruleset, there are just no guesses
+	vector<owner> globs;
+	read_ruleset(ruleset_file, globs);
+
+	uint64_t hosts = 0;
+	for (const auto& report: reports) {
+		vector<entry> entries;
+		if (!read_report(report, entries))
+			continue;
+		sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) { return a.path < b.path; });
+		entries.erase(unique(entries.begin(), entries.end(), [](const entry& a, const entry& b) { return a.path == b.path; }),
+		              entries.end());
+		run_writer run;
+		for (const auto& e: entries)
+			run.add(e);
+		add_run(run.finish());
+		hosts++;
+	}
+	if (hosts == 0)
+		return 1;
+
+	vector<FILE*> last;
+	for (auto& level: levels)
+		last.insert(last.end(), level.begin(), level.end());
+
+	buffered_output out;
+	out << "# hosts percent bytes package path (" << hosts << " hosts)\n";
+	merge_runs(last, [&](const entry& e) {
+		double percent = 100.0 * e.hosts / hosts;
+		if (percent < threshold)
+			return;
+		string_view package = "-";
+		for (const auto& glob: globs)
+			if (myglob(e.path, glob.path)) {
+				package = glob.package;
+				break;
+			}
+		out << e.hosts << ' ' << long(percent) << ' ' << e.bytes << ' ' << package << ' ' << e.path << '\n';
+	});
+	return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+#include "compat.h"
+
+// 64-bit FNV-1a, chained through 'hash' to cover several strings
+inline uint64_t fnv1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325ull)
+{
+	for (unsigned char c: data) {
+		hash ^= c;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
@@ -0,0 +1,249 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <iostream>
+
+#include "dpkg.h"
+#include "dpkg_exclude.h"
+#include "explain.h"
+#include "filters.h"
+#include "libcruft.h"
+#include "locate.h"
+#include "match.h"
+#include "python.h"
+#include "read_ignores.h"
+#include "scheduler.h"
+#include "shellexp.h"
+
+#ifndef BUSTER
+#include "nolocate.h"
+#endif
+
+using namespace std;
+
+struct cruft_engine::impl
+{
+	cruft_config config;
+	bool debug = getenv("DEBUG") != nullptr;
+
+	vector<string> packages;
+	// the shipped files, sorted, and the package of each one
+	vector<string> files;
+	vector<uint32_t> file_package;
+	vector<string> package_names;
+
+	vector<string> ignores;
+	vector<string> excludes;
+	vector<::owner> globs;
+	vector<::owner> explain;
+
+	string subtree = "/";
+	vector<string> fs;
+
+	bool inside(const string& path) const
+	{
+		return subtree == "/" || (path.size() > subtree.size()
+		                          && path.compare(0, subtree.size(), subtree) == 0
+		                          && path[subtree.size()] == '/');
+	}
+
+	// the shipped files below the scanned subtree
+	pair<vector<string>::const_iterator, vector<string>::const_iterator> shipped() const
+	{
+		if (subtree == "/")
+			return {files.begin(), files.end()};
+		// '0' comes right after '/'
+		return {lower_bound(files.begin(), files.end(), subtree + '/'),
+		        lower_bound(files.begin(), files.end(), subtree + '0')};
+	}
+};
+
+cruft_engine::cruft_engine(const cruft_config& config) : d(new impl)
+{
+	d->config = config;
+	if (!d->config.root_dir.empty() && d->config.root_dir.back() != '/')
+		d->config.root_dir += '/';
+}
+
+cruft_engine::~cruft_engine() = default;
+
+void cruft_engine::load_dpkg(const cruft_static_sink& sink)
+{
+	vector<pair<string, uint32_t>> shipped;
+	d->packages.clear();
+	d->package_names.clear();
+	dpkg_start(d->config.root_dir);
+	scan_dpkg(d->packages, [&](string&& path, const char* package) {
+		if (sink)
+			sink(path, package);
+		// the files of a package come one after the other; compare the
+		// names, a backend may pass the same buffer for every package
+		if (d->package_names.empty() || d->package_names.back() != package)
+			d->package_names.push_back(package);
+		shipped.emplace_back(std::move(path), d->package_names.size() - 1);
+	}, d->config.dpkg_csv, d->config.root_dir);
+	dpkg_end();
+
+	// a path shipped by several packages is kept once, from the first one
+	stable_sort(shipped.begin(), shipped.end(),
+	            [](const pair<string, uint32_t>& a, const pair<string, uint32_t>& b) { return a.first < b.first; });
+	shipped.erase(unique(shipped.begin(), shipped.end(),
+	                     [](const pair<string, uint32_t>& a, const pair<string, uint32_t>& b) { return a.first == b.first; }),
+	              shipped.end());
+	d->files.clear();
+	d->file_package.clear();
+	d->files.reserve(shipped.size());
+	d->file_package.reserve(shipped.size());
+	for (auto& file: shipped) {
+		d->files.emplace_back(std::move(file.first));
+		d->file_package.push_back(file.second);
+	}
+	if (d->debug) cerr << d->files.size() << " files in dpkg database\n";
+}
+
+void cruft_engine::load_rules()
+{
+	const cruft_config& config = d->config;
+	vector<string> ignores, excludes;
+	vector<::owner> globs, explain, explain_uppercase;
+
+	// the explain scripts of the root, not of the host
+	setenv("CRUFT_ROOT", config.root_dir == "/" ? "" : config.root_dir.c_str(), 0);
+
+	scheduler phases;
+	phases.add("read excludes", {}, [&] {
+		read_ignores(ignores, config.ignore_file);
+		read_dpkg_excludes(excludes);
+	});
+	phases.add("read filters", {}, [&] {
+		read_filters(config.filter_dir, config.ruleset_file, d->packages, globs);
+	});
+	phases.add("read explain uppercase", {}, [&] {
+		read_explain_uppercase(config.explain_dir, explain_uppercase);
+	});
+	phases.add("read explain", {}, [&] {
+		read_explain_packages(config.explain_dir, d->packages, explain);
+	});
+	phases.run();
+
+	explain.insert(explain.end(), explain_uppercase.begin(), explain_uppercase.end());
+	sort(explain.begin(), explain.end());
+	explain.erase( unique( explain.begin(), explain.end() ), explain.end() );
+
+	d->ignores = std::move(ignores);
+	d->excludes = std::move(excludes);
+	d->globs = std::move(globs);
+	d->explain = std::move(explain);
+}
+
+void cruft_engine::scan(const string& subtree)
+{
+	const cruft_config& config = d->config;
+	d->subtree = subtree;
+	if (d->subtree.size() > 1 && d->subtree.back() == '/')
+		d->subtree.pop_back();
+	d->fs.clear();
+
+	auto sink = [this](string&& path) {
+		if (d->inside(path))
+			d->fs.emplace_back(std::move(path));
+	};
+#ifndef BUSTER
+	if (!config.locate) {
+		if (d->subtree == "/")
+			scan_nolocate(sink, config.ignore_file, config.root_dir);
+		else
+			scan_nolocate_mount(sink, config.ignore_file, config.root_dir, d->subtree, {});
+	} else
+#endif
+		scan_locate(sink, config.ignore_file, config.root_dir);
+
+	sort(d->fs.begin(), d->fs.end());
+	d->fs.erase( unique( d->fs.begin(), d->fs.end() ), d->fs.end() );
+	if (d->debug) cerr << d->fs.size() << " relevant files in " << d->subtree << '\n';
+}
+
+void cruft_engine::extra(vector<string>& cruft) const
+{
+	auto range = d->shipped();
+	vector<string> dpkg(range.first, range.second);
+	vector<string> missing;
+	match_dpkg(d->fs, dpkg, cruft, missing);
+}
+
+void cruft_engine::classify(cruft_result& result) const
+{
+	auto range = d->shipped();
+	vector<string> dpkg(range.first, range.second);
+	vector<string> cruft, missing, cruft3;
+	match_dpkg(d->fs, dpkg, cruft, missing);
+	match_missing(missing, d->excludes, result.missing, d->debug);
+	vector<bool> used_globs;
+	match_globs(cruft, d->globs, used_globs, cruft3);
+	match_explain(cruft3, d->explain, result.unexplained);
+	result.scanned = d->fs.size();
+	result.shipped = dpkg.size();
+}
+
+cruft_verdict cruft_engine::owner(const string& path, string& package) const
+{
+	auto file = lower_bound(d->files.begin(), d->files.end(), path);
+	if (file != d->files.end() && *file == path) {
+		package = d->package_names[d->file_package[file - d->files.begin()]];
+		return cruft_static;
+	}
+	for (const auto& glob: d->globs)
+		if (myglob(path, glob.path)) {
+			package = glob.package;
+			return cruft_explained;
+		}
+	auto ex = lower_bound(d->explain.begin(), d->explain.end(), path,
+	                      [](const ::owner& o, const string& p) { return o.path < p; });
+	if (ex != d->explain.end() && ex->path == path) {
+		package = ex->package;
+		return cruft_explained;
+	}
+	package.clear();
+	return cruft_unexplained;
+}
+
+bool cruft_engine::ignored(const string& path) const
+{
+	// the same as the filesystem walk
+	for (const auto dir: {"/dev", "/home", "/media", "/mnt", "/proc", "/root", "/run", "/sys", "/tmp"}) {
+		size_t len = char_traits<char>::length(dir);
+		if (path.compare(0, len, dir) == 0 && path.size() > len && path[len] == '/')
+			return true;
+	}
+	for (const auto& ignore: d->ignores)
+		if (path.size() + 1 >= ignore.size() && path.compare(0, ignore.size() - 1, ignore, 0, ignore.size() - 1) == 0
+		    && (path.size() + 1 == ignore.size() || path[ignore.size() - 1] == '/'))
+			return true;
+	return pyc_has_py(d->config.root_dir + path.substr(1), d->debug);
+}
+
+bool cruft_engine::missing(const string& path) const
+{
+	if (!binary_search(d->files.begin(), d->files.end(), path))
+		return false;
+	for (const auto& ex: d->excludes)
+		if (myglob(path, ex))
+			return false;
+	return true;
+}
+
+const vector<string>& cruft_engine::packages() const
+{
+	return d->packages;
+}
+
+size_t cruft_engine::rules() const
+{
+	return d->globs.size();
+}
+
+size_t cruft_engine::explained() const
+{
+	return d->explain.size();
+}
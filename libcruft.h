@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/* the cruft-ng matching pipeline as a library:
+   read the dpkg database and the rules once, then scan and classify
+   as often as needed, or ask who owns a given path;
+   this header only uses standard types and keeps the engine state
+   behind a pointer, so programs built against it do not depend on
+   how the engine is implemented */
+
+struct cruft_config
+{
+	std::string root_dir = "/";
+	std::string ignore_file = "/etc/cruft/ignore";
+	std::string filter_dir = "/etc/cruft/filters/";
+	std::string ruleset_file = "/usr/share/cruft/ruleset";
+	std::string explain_dir = "/etc/cruft/explain/";
+	// plocate (or mlocate) database, else walk the filesystem
+	bool locate = true;
+	// print the shipped files as CSV while reading the dpkg database, for cpigs -C
+	bool dpkg_csv = false;
+};
+
+// same values as the binary export, see cruft-dump
+enum cruft_verdict : uint8_t
+{
+	cruft_static = 0,       // shipped by a package
+	cruft_explained = 1,    // matched by the ruleset or an explain script
+	cruft_unexplained = 2,
+};
+
+struct cruft_result
+{
+	std::vector<std::string> unexplained;
+	std::vector<std::string> missing;
+	size_t scanned = 0;
+	size_t shipped = 0;
+};
+
+// receives each file of the installed packages with its package name
+typedef std::function<void(const std::string&, const char*)> cruft_static_sink;
+
+class cruft_engine
+{
+public:
+	explicit cruft_engine(const cruft_config& config);
+	~cruft_engine();
+	cruft_engine(const cruft_engine&) = delete;
+	cruft_engine& operator=(const cruft_engine&) = delete;
+
+	// the installed packages and their files
+	void load_dpkg(const cruft_static_sink& sink = nullptr);
+	// the ruleset, the filters and the explain scripts of the installed packages,
+	// after load_dpkg(); may be called again when they changed
+	void load_rules();
+	void load() { load_dpkg(); load_rules(); }
+
+	// everything below 'subtree', "/" for the whole root; replaces the previous scan
+	void scan(const std::string& subtree = "/");
+	// the scanned files no package ships, sorted
+	void extra(std::vector<std::string>& cruft) const;
+	// the whole pipeline on the last scan
+	void classify(cruft_result& result) const;
+
+	// the package explaining 'path', empty when unexplained
+	cruft_verdict owner(const std::string& path, std::string& package) const;
+	// what scan() leaves out: the ignore file, /proc, /home..., .pyc files next to their .py
+	bool ignored(const std::string& path) const;
+	// 'path' is gone but a package ships it, and it is not in the dpkg excludes
+	bool missing(const std::string& path) const;
+
+	const std::vector<std::string>& packages() const;
+	size_t rules() const;
+	size_t explained() const;
+
+private:
+	struct impl;
+	std::unique_ptr<impl> d;
+};
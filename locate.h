@@ -1,6 +1,14 @@
+#include <functional>
 #include <vector>
 #include <string>
 
+#ifndef LOCATE_H
+#define LOCATE_H
 using namespace std;
 
+// receives the scanned paths one by one, unsorted
+typedef function<void(string&&)> path_sink;
+
 int read_locate(vector<string>& fs, const string& ignore_path, const string& root_dir);
+int scan_locate(const path_sink& sink, const string& ignore_path, const string& root_dir);
+#endif
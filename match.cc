@@ -0,0 +1,95 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <iostream>
+#include <algorithm>
+#include <sys/stat.h>
+
+#include "counters.h"
+#include "match.h"
+#include "shellexp.h"
+
+using namespace std;
+
+// match two main data sources
+void match_dpkg(const vector<string>& fs, const vector<string>& dpkg, vector<string>& cruft, vector<string>& missing)
+{
+	auto left=fs.begin();
+	auto right=dpkg.begin();
+	while (left != fs.end() && right != dpkg.end())
+	{
+		//cerr << "[" << *left << "=" << *right << "]" << endl;
+		if (*left==*right) {
+			left++;
+			right++;
+		} else if (*left < *right) {
+			cruft.push_back(*left);
+			left++;
+		} else {
+			missing.push_back(*right);
+			right++;
+		}
+	}
+	cruft.insert(cruft.end(), left, fs.end());
+	missing.insert(missing.end(), right, dpkg.end());
+}
+
+// https://bugs.debian.org/cgi-bin/bugreport.cgi?bug=619086
+void match_missing(const vector<string>& missing, const vector<string>& excludes, vector<string>& missing2, bool debug)
+{
+	match_missing(missing, excludes, missing2, debug, [](const string& path) {
+		struct stat stat_buffer;
+		return counted_stat(path.c_str(), &stat_buffer) == 0;
+	});
+}
+
+void match_missing(const vector<string>& missing, const vector<string>& excludes, vector<string>& missing2, bool debug,
+                   const function<bool(const string&)>& exists)
+{
+	unsigned long count_stat = 0;
+	for (const auto& miss: missing) {
+		bool match=false;
+		for (const auto& ex: excludes) {
+			match=myglob(miss,ex);
+			if (match) break;
+		}
+		if (!match) {
+			// file may exist on tmpfs
+			// e.g.: /var/cache/apt/archives/partial
+			if (exists(miss)) {
+				count_stat += 1;
+				if (debug) cerr << miss << " was not in plocate database\n";
+			} else {
+				missing2.push_back(miss);
+			}
+		}
+	}
+	if (debug) cerr << "count stat():" << count_stat << '\n';
+}
+
+// match the globs against reduced database
+void match_globs(const vector<string>& cruft, const vector<owner>& globs, vector<bool>& used_globs, vector<string>& cruft3)
+{
+	used_globs.resize(globs.size(), false);
+	for (const auto& cr: cruft) {
+		bool match=false;
+		for (size_t i = 0; i < globs.size(); i++) {
+			match=myglob(cr, globs[i].path);
+			if (match) {
+				used_globs[i] = true;
+				break;
+			}
+		}
+		if (!match) cruft3.push_back(cr);
+	}
+}
+
+// match the dynamic "explain" filters, 'explain' is sorted by path
+void match_explain(const vector<string>& cruft3, const vector<owner>& explain, vector<string>& cruft4)
+{
+	for (const auto& cr: cruft3) {
+		auto ex = lower_bound(explain.begin(), explain.end(), cr,
+		                      [](const owner& l, const string& r) { return l.path < r; });
+		if (ex == explain.end() || ex->path != cr) cruft4.push_back(cr);
+	}
+}
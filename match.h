@@ -0,0 +1,16 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <string>
+
+#include "owner.h"
+
+// all inputs are sorted
+void match_dpkg(const std::vector<std::string>& fs, const std::vector<std::string>& dpkg, std::vector<std::string>& cruft, std::vector<std::string>& missing);
+void match_missing(const std::vector<std::string>& missing, const std::vector<std::string>& excludes, std::vector<std::string>& missing2, bool debug);
+// same, 'exists' tells if a file is there all the same, instead of stat()
+void match_missing(const std::vector<std::string>& missing, const std::vector<std::string>& excludes, std::vector<std::string>& missing2, bool debug,
+                   const std::function<bool(const std::string&)>& exists);
+void match_globs(const std::vector<std::string>& cruft, const std::vector<owner>& globs, std::vector<bool>& used_globs, std::vector<std::string>& cruft3);
+void match_explain(const std::vector<std::string>& cruft3, const std::vector<owner>& explain, std::vector<std::string>& cruft4);
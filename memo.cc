@@ -0,0 +1,115 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+#include "hash.h"
+#include "match.h"
+#include "memo.h"
+
+using namespace std;
+
+/* the cache is a text file:
+     cruft-verdicts 1 <ruleset id>
+   then for each directory
+     <key> <number of unmatched entries> <directory>
+     <unmatched entry>...  */
+static const char header[] = "cruft-verdicts 1 ";
+
+verdict_cache::verdict_cache(const string& file_, const vector<owner>& globs) : file(file_)
+{
+	uint64_t id = fnv1a("");
+	for (const auto& glob: globs) {
+		id = fnv1a(glob.path, id);
+		id = fnv1a(string_view("", 1), id);
+	}
+	ruleset_id = id;
+
+	ifstream in(file);
+	string line;
+	if (!getline(in, line) || line != header + to_string(ruleset_id))
+		return;
+
+	while (getline(in, line)) {
+		char* end;
+		uint64_t key = strtoull(line.c_str(), &end, 10);
+		size_t count = strtoull(end, &end, 10);
+		if (*end != ' ') {
+			cached.clear();
+			return;
+		}
+		directory& dir = cached[end + 1];
+		dir.key = key;
+		for (size_t i = 0; i < count && getline(in, line); i++)
+			dir.unmatched.push_back(line);
+	}
+}
+
+void verdict_cache::match_globs(const vector<string>& cruft, const vector<owner>& globs,
+                                vector<bool>& used_globs, vector<string>& cruft3)
+{
+	// the entries of a directory are not contiguous in sorted order:
+	// "/a/b" < "/a/b/c" < "/a/c"
+	vector<string> order;
+	unordered_map<string, vector<const string*>> entries;
+	for (const auto& cr: cruft) {
+		string parent = cr.substr(0, cr.rfind('/'));
+		auto& list = entries[parent];
+		if (list.empty())
+			order.push_back(parent);
+		list.push_back(&cr);
+	}
+
+	used_globs.resize(globs.size(), false);
+	current.clear();
+	for (const auto& parent: order) {
+		const auto& list = entries[parent];
+		uint64_t key = fnv1a("");
+		for (auto cr: list)
+			key = fnv1a(string_view(*cr).substr(parent.size()), key);
+
+		directory& dir = current[parent];
+		dir.key = key;
+		auto found = cached.find(parent);
+		if (found != cached.end() && found->second.key == key) {
+			hits++;
+			dir.unmatched = std::move(found->second.unmatched);
+		} else {
+			misses++;
+			vector<string> paths, unmatched;
+			for (auto cr: list)
+				paths.push_back(*cr);
+			::match_globs(paths, globs, used_globs, unmatched);
+			for (const auto& path: unmatched)
+				dir.unmatched.push_back(path.substr(parent.size() + 1));
+		}
+		for (const auto& name: dir.unmatched)
+			cruft3.push_back(parent + '/' + name);
+	}
+	sort(cruft3.begin(), cruft3.end());
+	cached.clear();
+}
+
+bool verdict_cache::save() const
+{
+	// written next to the cache, then renamed over it
+	string tmp = file + ".tmp";
+	ofstream out(tmp, ios::trunc);
+	out << header << ruleset_id << '\n';
+	for (const auto& dir: current) {
+		out << dir.second.key << ' ' << dir.second.unmatched.size() << ' ' << dir.first << '\n';
+		for (const auto& name: dir.second.unmatched)
+			out << name << '\n';
+	}
+	out.close();
+	if (!out || rename(tmp.c_str(), file.c_str()) != 0) {
+		cerr << "cannot write " << file << ": " << strerror(errno) << '\n';
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "owner.h"
+
+/* remembers, per directory, which of its cruft entries the globs
+   did not match; a directory is only matched again when its cruft
+   entries or the rules changed since the run that saved the cache */
+class verdict_cache
+{
+public:
+	// an unreadable or outdated 'file' just means an empty cache
+	verdict_cache(const std::string& file, const std::vector<owner>& globs);
+
+	// same as match_globs(), 'used_globs' only covers the directories matched again
+	void match_globs(const std::vector<std::string>& cruft, const std::vector<owner>& globs,
+	                 std::vector<bool>& used_globs, std::vector<std::string>& cruft3);
+	// keeps only the directories seen by the last match_globs()
+	bool save() const;
+
+	size_t hits = 0;
+	size_t misses = 0;
+
+private:
+	struct directory
+	{
+		uint64_t key;
+		std::vector<std::string> unmatched;
+	};
+	std::string file;
+	uint64_t ruleset_id;
+	std::unordered_map<std::string, directory> cached;
+	std::unordered_map<std::string, directory> current;
+};
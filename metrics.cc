@@ -0,0 +1,142 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "columns.h"
+#include "metrics.h"
+
+using namespace std;
+
+metrics_writer::metrics_writer(function<string(const string&)> mount_of_)
+	: mount_of(std::move(mount_of_))
+{
+}
+
+// "/var/lib/foo" is in "/var"
+static string top_directory(const string& path)
+{
+	return path.substr(0, path.find('/', 1));
+}
+
+void metrics_writer::add(const string& path, uint8_t verdict, uint64_t size)
+{
+	auto& counted = places[verdict][{mount_of(path), top_directory(path)}];
+	counted.paths++;
+	counted.bytes += size;
+}
+
+// a label value, with \ " and newlines escaped
+static string quoted(const string& value)
+{
+	string q = "\"";
+	for (char c: value) {
+		if (c == '\\')
+			q += "\\\\";
+		else if (c == '"')
+			q += "\\\"";
+		else if (c == '\n')
+			q += "\\n";
+		else
+			q += c;
+	}
+	return q + '"';
+}
+
+static void family(ostream& out, const char* name, const char* help)
+{
+	out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << " gauge\n";
+}
+
+static double seconds(const timeval& tv)
+{
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+bool metrics_writer::write(const string& file,
+                           const vector<pair<string, uintmax_t>>& counts,
+                           const vector<phase_timing>& timings,
+                           const uint64_t total[op_counters])
+{
+	// the textfile collector only reads *.prom, and this is not one
+	string tmp = file + ".tmp";
+	ofstream out(tmp, ios::trunc);
+	out.precision(15);
+
+	family(out, "cruft_paths", "Paths reported, by verdict, mount point and top-level directory.");
+	for (const auto& verdict: places)
+		for (const auto& p: verdict.second)
+			out << "cruft_paths{verdict=" << quoted(verdict_name(verdict.first))
+			    << ",mount=" << quoted(p.first.first) << ",directory=" << quoted(p.first.second)
+			    << "} " << p.second.paths << '\n';
+	family(out, "cruft_bytes", "Size of the unexplained paths, by mount point and top-level directory.");
+	for (const auto& p: places[verdict_unexplained])
+		out << "cruft_bytes{verdict=" << quoted(verdict_name(verdict_unexplained))
+		    << ",mount=" << quoted(p.first.first) << ",directory=" << quoted(p.first.second)
+		    << "} " << p.second.bytes << '\n';
+
+	if (!estimates.empty()) {
+		auto figures = [](const estimate_totals& e) {
+			return vector<pair<const char*, estimate_figure>>{{"entries", e.entries}, {"unexplained", e.unexplained}, {"bytes", e.bytes}};
+		};
+		family(out, "cruft_estimate", "The --estimate figures, by top-level directory.");
+		for (const auto& e: estimates)
+			for (const auto& figure: figures(e))
+				out << "cruft_estimate{section=" << quoted(e.section) << ",figure=" << quoted(figure.first)
+				    << "} " << figure.second.value << '\n';
+		family(out, "cruft_estimate_margin", "Half the width of the 95% confidence interval of the --estimate figures.");
+		for (const auto& e: estimates)
+			for (const auto& figure: figures(e))
+				out << "cruft_estimate_margin{section=" << quoted(e.section) << ",figure=" << quoted(figure.first)
+				    << "} " << figure.second.margin() << '\n';
+	}
+
+	family(out, "cruft_count", "The counts of the report, as in its structured formats.");
+	for (const auto& count: counts)
+		out << "cruft_count{name=" << quoted(count.first) << "} " << count.second << '\n';
+
+	family(out, "cruft_phase_start_seconds", "When each phase started, since the start of the phases.");
+	for (const auto& timing: timings)
+		out << "cruft_phase_start_seconds{phase=" << quoted(timing.name) << "} " << timing.start_ms / 1e3 << '\n';
+	family(out, "cruft_phase_seconds", "Wall time of each phase.");
+	for (const auto& timing: timings)
+		out << "cruft_phase_seconds{phase=" << quoted(timing.name) << "} " << timing.ms / 1e3 << '\n';
+	family(out, "cruft_phase_cpu_seconds", "CPU time of the thread of each phase, without the commands it ran.");
+	for (const auto& timing: timings)
+		out << "cruft_phase_cpu_seconds{phase=" << quoted(timing.name) << "} " << timing.cpu_ms / 1e3 << '\n';
+	family(out, "cruft_phase_operations", "Operations done by the thread of each phase.");
+	for (const auto& timing: timings)
+		for (int i = 0; i < op_counters; i++)
+			if (timing.ops[i])
+				out << "cruft_phase_operations{phase=" << quoted(timing.name)
+				    << ",op=" << quoted(op_name(i)) << "} " << timing.ops[i] << '\n';
+	family(out, "cruft_operations", "Operations done by the whole run.");
+	for (int i = 0; i < op_counters; i++)
+		out << "cruft_operations{op=" << quoted(op_name(i)) << "} " << total[i] << '\n';
+
+	struct rusage self, children;
+	getrusage(RUSAGE_SELF, &self);
+	getrusage(RUSAGE_CHILDREN, &children);
+	family(out, "cruft_cpu_seconds", "CPU time of the run, and of the commands it ran.");
+	out << "cruft_cpu_seconds{mode=\"user\"} " << seconds(self.ru_utime) << '\n';
+	out << "cruft_cpu_seconds{mode=\"system\"} " << seconds(self.ru_stime) << '\n';
+	out << "cruft_cpu_seconds{mode=\"children\"} " << seconds(children.ru_utime) + seconds(children.ru_stime) << '\n';
+	family(out, "cruft_max_rss_bytes", "Peak resident memory of the run.");
+	out << "cruft_max_rss_bytes " << self.ru_maxrss * 1024L << '\n';
+	family(out, "cruft_last_run_timestamp_seconds", "When the run ended.");
+	out << "cruft_last_run_timestamp_seconds " << long(time(nullptr)) << '\n';
+
+	out.close();
+	if (!out || rename(tmp.c_str(), file.c_str()) != 0) {
+		cerr << "cannot write " << file << ": " << strerror(errno) << '\n';
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
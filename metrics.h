@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "counters.h"
+#include "estimate.h"
+#include "scheduler.h"
+
+/* the figures of a run in the Prometheus text format, for the
+   textfile collector of node_exporter: the reported paths and their
+   bytes by mount point and top-level directory, the report counts,
+   and the time, CPU and operations of each phase; all gauges, each
+   run replaces the file */
+class metrics_writer
+{
+public:
+	// mount_of gives the mount point holding a path
+	explicit metrics_writer(std::function<std::string(const std::string&)> mount_of);
+	// a reported path, see enum verdict in columns.h
+	void add(const std::string& path, uint8_t verdict, uint64_t size);
+	// the figures of --estimate
+	void estimate(const estimate_totals& totals) { estimates.push_back(totals); }
+	// written next to the target, then renamed over it; false if that fails
+	bool write(const std::string& file,
+	           const std::vector<std::pair<std::string, uintmax_t>>& counts,
+	           const std::vector<phase_timing>& timings,
+	           const uint64_t total[op_counters]);
+
+private:
+	struct place
+	{
+		uintmax_t paths = 0;
+		uintmax_t bytes = 0;
+	};
+	std::function<std::string(const std::string&)> mount_of;
+	// by verdict, mount point and top-level directory
+	std::map<uint8_t, std::map<std::pair<std::string, std::string>, place>> places;
+	std::vector<estimate_totals> estimates;
+};
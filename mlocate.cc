@@ -11,11 +11,12 @@
 #include "locate.h"
 #include "python.h"
 
+// also built as C++17 for bench-scanold, where "filesystem" alone
+// would be ambiguous between std and std::experimental
 #include <experimental/filesystem>
-using namespace std::experimental;
 namespace fs = std::experimental::filesystem;
 
-int read_locate(vector<string>& fs, const string& ignore_path, const string& root_dir) // vector<string>& prunefs
+int scan_locate(const path_sink& sink, const string& ignore_path, const string& root_dir) // vector<string>& prunefs
 {
 	bool debug=getenv("DEBUG") != NULL;
 
@@ -90,26 +91,34 @@ int read_locate(vector<string>& fs, const string& ignore_path, const string& roo
 			getline(mlocate,filename,'\0');
 			string fullpath=dirname + '/' + filename;
 			if (!pyc_has_py(fullpath, debug))
-				fs.emplace_back(fullpath);
+				sink(std::move(fullpath));
 		}
 	}
 	mlocate.close();
 
 	// default PRUNEPATH in /etc/updatedb.conf
-	fs.emplace_back("/var/spool");
+	sink("/var/spool");
 	try {
-		for (const auto& entry: filesystem::recursive_directory_iterator{"/var/spool", filesystem::directory_options::skip_permission_denied})
+		for (const auto& entry: fs::recursive_directory_iterator{"/var/spool", fs::directory_options::skip_permission_denied})
 		{
-			fs.emplace_back(entry.path());
+			sink(entry.path().string());
 		}
 	} catch(const exception& e) {
 		cerr << "Failed to iterate directory /var/spool/: " << e.what() << endl;
 	}
 
+	//if (debug) cerr << prunefs.size() << " relevant records in PRUNEFS database" << endl;
+	return 0;
+}
+
+int read_locate(vector<string>& fs, const string& ignore_path, const string& root_dir)
+{
+	bool debug=getenv("DEBUG") != NULL;
+
+	int rc = scan_locate([&fs](string&& path) { fs.emplace_back(std::move(path)); }, ignore_path, root_dir);
+
         sort(fs.begin(), fs.end());
         fs.erase( unique( fs.begin(), fs.end() ), fs.end() );
-
-	//if (debug) cerr << prunefs.size() << " relevant records in PRUNEFS database" << endl;
 	if (debug) cerr << fs.size() << " relevant files in MLOCATE database"  << endl << endl;
-	return 0;
+	return rc;
 }
@@ -0,0 +1,111 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#include "mounts.h"
+
+using namespace std;
+
+// virtual filesystems, mostly the same as PRUNEFS in /etc/updatedb.conf
+static const set<string> pseudo_fs {
+	"autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs",
+	"debugfs", "devpts", "devtmpfs", "efivarfs", "fusectl", "fuse.gvfsd-fuse",
+	"hugetlbfs", "mqueue", "nfsd", "nsfs", "proc", "pstore", "ramfs",
+	"rpc_pipefs", "securityfs", "selinuxfs", "sysfs", "tmpfs", "tracefs",
+};
+
+// cruft never looks into these
+static bool skipped(const string& point)
+{
+	for (const auto dir: {"/dev", "/home", "/media", "/mnt", "/proc", "/root", "/run", "/sys", "/tmp"}) {
+		size_t len = char_traits<char>::length(dir);
+		if (point.compare(0, len, dir) == 0 && (point.size() == len || point[len] == '/'))
+			return true;
+	}
+	return false;
+}
+
+// mountinfo escapes ' ', '\t', '\n' and '\\' as octal
+static string unescape(const string& field)
+{
+	string out;
+	for (size_t i = 0; i < field.size(); i++) {
+		if (field[i] == '\\' && i + 3 < field.size()) {
+			out += char(stoi(field.substr(i + 1, 3), nullptr, 8));
+			i += 3;
+		} else {
+			out += field[i];
+		}
+	}
+	return out;
+}
+
+int read_mounts(vector<mount>& mounts, const string& root_dir)
+{
+	bool debug=getenv("DEBUG") != nullptr;
+
+	ifstream mountinfo("/proc/self/mountinfo");
+	if (!mountinfo.is_open()) {
+		cerr << "can't read /proc/self/mountinfo\n";
+		return 1;
+	}
+
+	// root_dir always ends with '/'
+	string root = root_dir.substr(0, root_dir.size() - 1);
+
+	for (string line; getline(mountinfo, line);) {
+		istringstream fields(line);
+		string id, parent, devno, source_root, point, options, field;
+		fields >> id >> parent >> devno >> source_root >> point >> options;
+		while (fields >> field && field != "-");
+		mount m;
+		fields >> m.type >> m.device;
+
+		point = unescape(point);
+		if (pseudo_fs.count(m.type)) continue;
+		if (!root.empty()) {
+			if (point.compare(0, root.size(), root) != 0) continue;
+			if (point.size() > root.size() && point[root.size()] != '/') continue;
+			point = point.substr(root.size());
+		}
+		m.point = point.empty() ? "/" : point;
+		if (skipped(m.point)) continue;
+
+		// the last mount on a directory hides the previous ones
+		mounts.erase(remove_if(mounts.begin(), mounts.end(),
+		                       [&m](const mount& old) { return old.point == m.point; }),
+		             mounts.end());
+		mounts.emplace_back(std::move(m));
+	}
+
+	if (none_of(mounts.begin(), mounts.end(), [](const mount& m) { return m.point == "/"; }))
+		mounts.push_back({"/", "", ""});
+
+	sort(mounts.begin(), mounts.end(), [](const mount& l, const mount& r) { return l.point < r.point; });
+	if (debug)
+		for (const auto& m: mounts)
+			cerr << "MOUNT " << m.point << " " << m.type << " " << m.device << '\n';
+	return 0;
+}
+
+const mount& mount_of(const string& path, const vector<mount>& mounts)
+{
+	const mount* best = nullptr;
+	for (const auto& m: mounts) {
+		if (m.point == "/") {
+			if (best == nullptr) best = &m;
+		} else if (path.size() > m.point.size()
+		           && path.compare(0, m.point.size(), m.point) == 0
+		           && path[m.point.size()] == '/') {
+			if (best == nullptr || m.point.size() > best->point.size()) best = &m;
+		}
+	}
+	// a table without "/", e.g. from a failed read_mounts()
+	static const mount root = {"/", "", ""};
+	return best == nullptr ? root : *best;
+}
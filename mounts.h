@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct mount
+{
+	std::string point;   // relative to the root directory, e.g. "/var"
+	std::string type;
+	std::string device;
+};
+
+// real filesystems mounted below root_dir, sorted by mount point
+int read_mounts(std::vector<mount>& mounts, const std::string& root_dir);
+
+// the filesystem holding 'path', a mount point itself belongs to its parent;
+// a plain "/" when no mount of 'mounts' holds it
+const mount& mount_of(const std::string& path, const std::vector<mount>& mounts);
@@ -10,13 +10,137 @@
 #include <sys/vfs.h>
 #include <linux/magic.h>
 
+#include "counters.h"
 #include "nolocate.h"
+#include "progress.h"
 #include "python.h"
 #include "read_ignores.h"
 
 using namespace std;
 
-int read_nolocate(vector<string>& fs, const string& ignore_path, const string& root_dir)
+static bool descend(const string& filename)
+{
+	struct statfs buf;
+
+	counted_statfs(filename.c_str(), &buf);
+
+	return !(buf.f_type == SYSFS_MAGIC
+	    or buf.f_type == PROC_SUPER_MAGIC
+	    or filename == "/dev"
+	    or (filename == "/home" /* and dirname != "/home" */)
+	    or filename == "/media"
+	    or filename == "/mnt"
+	    or filename == "/run"
+	    or filename == "/root"
+	    or filename == "/tmp");
+}
+
+// returns false if the directory should not be descended into
+static bool one_entry(const filesystem::directory_entry& entry, size_t root_dir_length, const vector<string>& ignores, const path_sink& sink, bool debug)
+{
+	count_op(op_paths);
+	std::string filename{entry.path(), root_dir_length};
+	bool recurse = descend(filename);
+	error_code ec;
+	if (recurse && entry.is_directory(ec) && !entry.is_symlink(ec))
+		count_op(op_opendir);
+
+	for (const auto& it : ignores) {
+		if (filename.size() > it.size() && filename.compare(0, it.size(), it) == 0)
+			return recurse;
+
+		// ignore directory '/foo' for ignore entry '/foo/'
+		if (filename.size() + 1 == it.size()
+		&& it.compare(0, filename.size(), filename) == 0
+		&& filesystem::is_directory(filename, ec))
+			return recurse;
+	}
+
+	if (!pyc_has_py(string{entry.path()}, debug))
+		sink(std::move(filename));
+	return recurse;
+}
+
+/* depth first below 'dir', like recursive_directory_iterator, but a
+   directory that cannot be read, e.g. one removed during the scan, is
+   reported and skipped instead of ending the whole walk: the files not
+   seen would otherwise show up as missing without a word;
+   'visit' returns false if the directory should not be descended into */
+static void walk(const filesystem::path& dir, const function<bool(const filesystem::directory_entry&)>& visit)
+{
+	const auto options = filesystem::directory_options::skip_permission_denied;
+	error_code ec;
+	vector<pair<filesystem::path, filesystem::directory_iterator>> stack;
+	stack.emplace_back(dir, filesystem::directory_iterator{dir, options, ec});
+	if (ec) {
+		cerr << "cannot read " << dir.string() << ": " << ec.message() << '\n';
+		return;
+	}
+	while (!stack.empty()) {
+		auto& it = stack.back().second;
+		if (it == filesystem::directory_iterator()) {
+			stack.pop_back();
+			continue;
+		}
+		const filesystem::directory_entry entry = *it;
+		it.increment(ec);
+		if (ec) {
+			cerr << "cannot read " << stack.back().first.string() << ": " << ec.message() << '\n';
+			it = filesystem::directory_iterator();
+		}
+		if (!visit(entry) || !entry.is_directory(ec) || entry.is_symlink(ec))
+			continue;
+		filesystem::directory_iterator below{entry.path(), options, ec};
+		if (ec) {
+			cerr << "cannot read " << entry.path().string() << ": " << ec.message() << '\n';
+			continue;
+		}
+		stack.emplace_back(entry.path(), std::move(below));
+	}
+}
+
+// the top-level entries, those named in 'first' ahead of the others
+static vector<filesystem::directory_entry> toplevel_entries(const string& root_dir, const vector<string>& first)
+{
+	auto root_dir_length = root_dir.length()-1;
+	auto rank = [&](const filesystem::directory_entry& entry) {
+		std::string filename{entry.path(), root_dir_length};
+		return find(first.begin(), first.end(), filename) - first.begin();
+	};
+
+	vector<filesystem::directory_entry> toplevel;
+	error_code ec;
+	for (const auto& entry: filesystem::directory_iterator{root_dir, filesystem::directory_options::skip_permission_denied, ec})
+		toplevel.push_back(entry);
+	sort(toplevel.begin(), toplevel.end(), [&](const filesystem::directory_entry& a, const filesystem::directory_entry& b) {
+		auto rank_a = rank(a), rank_b = rank(b);
+		return rank_a != rank_b ? rank_a < rank_b : a < b;
+	});
+	return toplevel;
+}
+
+vector<string> nolocate_toplevel(const string& root_dir, const vector<string>& first)
+{
+	auto root_dir_length = root_dir.length()-1;
+
+	vector<string> dirs;
+	error_code ec;
+	for (const auto& top: toplevel_entries(root_dir, first)) {
+		std::string filename{top.path(), root_dir_length};
+		if (top.is_directory(ec) && !top.is_symlink(ec) && descend(filename))
+			dirs.push_back(filename);
+	}
+	return dirs;
+}
+
+int scan_nolocate(const path_sink& sink, const string& ignore_path, const string& root_dir)
+{
+	return scan_nolocate_ordered(sink, ignore_path, root_dir, {});
+}
+
+/* the top-level directories are walked one after the other in sorted order,
+   after those in 'first', so all the files of a top-level directory come in one block */
+int scan_nolocate_ordered(const path_sink& sink, const string& ignore_path, const string& root_dir, const vector<string>& first)
 {
 	bool debug=getenv("DEBUG") != nullptr;
 
@@ -27,56 +151,81 @@ int read_nolocate(vector<string>& fs, const string& ignore_path, const string& r
 	vector<string> ignores;
 	read_ignores(ignores, ignore_path);
 
-	fs.emplace_back("/.");
+	sink("/.");
 
-	struct statfs buf;
 	auto root_dir_length = root_dir.length()-1;
 
-        for (auto entry =
-                 filesystem::recursive_directory_iterator{
-                     root_dir,
-                     filesystem::directory_options::skip_permission_denied};
-             entry != filesystem::recursive_directory_iterator(); entry++)
+	error_code ec;
+	for (const auto& top: toplevel_entries(root_dir, first))
 	{
-		std::string filename{entry->path(), root_dir_length};
-
-		statfs(filename.c_str(), &buf);
-
-		if (buf.f_type == SYSFS_MAGIC
-		    or buf.f_type == PROC_SUPER_MAGIC
-		    or filename == "/dev"
-		    or (filename == "/home" /* and dirname != "/home" */)
-		    or filename == "/media"
-		    or filename == "/mnt"
-		    or filename == "/run"
-		    or filename == "/root"
-		    or filename == "/tmp")
-			entry.disable_recursion_pending();
-
-		bool ignored = false;
-		for (const auto& it : ignores) {
-			if (filename.size() > it.size() && filename.compare(0, it.size(), it) == 0) {
-				ignored = true;
-				break;
-			}
-
-			// ignore directory '/foo' for ignore entry '/foo/'
-			error_code ec;
-			if (filename.size() + 1 == it.size()
-			&& it.compare(0, filename.size(), filename) == 0
-			&& filesystem::is_directory(filename, ec)) {
-				ignored = true;
-				break;
-			}
+		progress_where(top.path().string());
+		if (!one_entry(top, root_dir_length, ignores, sink, debug))
+			continue;
+		if (!top.is_directory(ec) || top.is_symlink(ec))
+			continue;
+
+		walk(top.path(), [&](const filesystem::directory_entry& entry) {
+			return one_entry(entry, root_dir_length, ignores, sink, debug);
+		});
+	}
+	return 0;
+}
+
+// walk one filesystem, the other mount points in 'prune' are left to their own walk
+int scan_nolocate_mount(const path_sink& sink, const string& ignore_path, const string& root_dir, const string& point, const vector<string>& prune)
+{
+	bool debug=getenv("DEBUG") != nullptr;
+
+	if (debug) cerr << "FILESYSTEM DATA " << point << '\n';
+	progress_where(root_dir + point.substr(1));
+
+	init_python();
+
+	vector<string> ignores;
+	read_ignores(ignores, ignore_path);
+
+	if (point == "/")
+		sink("/.");
+
+	auto root_dir_length = root_dir.length()-1;
+
+	walk(root_dir + point.substr(1), [&](const filesystem::directory_entry& entry) {
+		bool recurse = one_entry(entry, root_dir_length, ignores, sink, debug);
+		if (recurse && !prune.empty()) {
+			std::string filename{entry.path(), root_dir_length};
+			recurse = find(prune.begin(), prune.end(), filename) == prune.end();
 		}
-		if (ignored) continue;
+		return recurse;
+	});
+	return 0;
+}
+
+void list_nolocate(const string& dir, const vector<string>& ignores, const string& root_dir, vector<string>& entries, vector<string>& subdirs)
+{
+	bool debug=getenv("DEBUG") != nullptr;
+
+	init_python();
+	progress_where(root_dir + dir.substr(1));
+
+	auto root_dir_length = root_dir.length()-1;
+	auto sink = [&entries](string&& path) { entries.emplace_back(std::move(path)); };
 
-		if (!pyc_has_py(string{entry->path()}, debug))
-			fs.emplace_back(filename);
+	error_code ec;
+	for (const auto& entry: filesystem::directory_iterator{root_dir + dir.substr(1), filesystem::directory_options::skip_permission_denied, ec})
+	{
+		if (one_entry(entry, root_dir_length, ignores, sink, debug) && entry.is_directory(ec) && !entry.is_symlink(ec))
+			subdirs.emplace_back(entry.path(), root_dir_length);
 	}
+}
+
+int read_nolocate(vector<string>& fs, const string& ignore_path, const string& root_dir)
+{
+	bool debug=getenv("DEBUG") != nullptr;
+
+	int rc = scan_nolocate([&fs](string&& path) { fs.emplace_back(std::move(path)); }, ignore_path, root_dir);
 
 	sort(fs.begin(), fs.end());
 	fs.erase( unique( fs.begin(), fs.end() ), fs.end() );
 	if (debug) cerr << fs.size() << " relevant files in filesystem"  << endl << endl;
-	return 0;
+	return rc;
 }
@@ -4,9 +4,19 @@
 #include <vector>
 #include <string>
 
+#include "locate.h"
+
 #ifndef NOLOCATE_H
 #define NOLOCATE_H
 using namespace std;
 
 int read_nolocate(vector<string>& fs, const string& ignore_path, const string& root_dir);
+int scan_nolocate(const path_sink& sink, const string& ignore_path, const string& root_dir);
+// same, the top-level directories named in 'first' are walked first, in that order
+int scan_nolocate_ordered(const path_sink& sink, const string& ignore_path, const string& root_dir, const vector<string>& first);
+// the top-level directories that scan_nolocate_ordered() walks into, in the same order
+vector<string> nolocate_toplevel(const string& root_dir, const vector<string>& first);
+int scan_nolocate_mount(const path_sink& sink, const string& ignore_path, const string& root_dir, const string& point, const vector<string>& prune);
+// one directory 'dir' below root_dir: the entries the scan reports and the subdirectories it walks into
+void list_nolocate(const string& dir, const vector<string>& ignores, const string& root_dir, vector<string>& entries, vector<string>& subdirs);
 #endif
@@ -0,0 +1,125 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+#include "output.h"
+
+using namespace std;
+
+buffered_output::buffered_output(int fd_, size_t capacity_) : fd(fd_), capacity(capacity_)
+{
+	buffer.reserve(capacity);
+}
+
+buffered_output::~buffered_output()
+{
+	flush();
+}
+
+void buffered_output::flush()
+{
+	const char* data = buffer.data();
+	size_t left = buffer.size();
+	while (left > 0) {
+		ssize_t written = write(fd, data, left);
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			cerr << "write failed: " << strerror(errno) << '\n';
+			exit(1);
+		}
+		data += written;
+		left -= written;
+	}
+	buffer.clear();
+}
+
+buffered_output& buffered_output::operator<<(string_view text)
+{
+	if (buffer.size() + text.size() > capacity)
+		flush();
+	buffer.append(text.data(), text.size());
+	return *this;
+}
+
+buffered_output& buffered_output::operator<<(char c)
+{
+	if (buffer.size() + 1 > capacity)
+		flush();
+	buffer.push_back(c);
+	return *this;
+}
+
+buffered_output& buffered_output::operator<<(uintmax_t number)
+{
+	char digits[24];
+	auto end = to_chars(digits, digits + sizeof(digits), number).ptr;
+	return *this << string_view(digits, end - digits);
+}
+
+buffered_output& buffered_output::operator<<(long number)
+{
+	char digits[24];
+	auto end = to_chars(digits, digits + sizeof(digits), number).ptr;
+	return *this << string_view(digits, end - digits);
+}
+
+// the length of the well-formed UTF-8 sequence starting at 'i', 0 if there is none
+static size_t utf8_length(string_view text, size_t i)
+{
+	unsigned char c = text[i];
+	size_t length;
+	unsigned char low = 0x80, high = 0xbf; // range of the second byte
+	if (c >= 0xc2 && c <= 0xdf) length = 2;
+	else if (c == 0xe0) { length = 3; low = 0xa0; }
+	else if (c == 0xed) { length = 3; high = 0x9f; } // no surrogates
+	else if (c >= 0xe1 && c <= 0xef) length = 3;
+	else if (c == 0xf0) { length = 4; low = 0x90; }
+	else if (c == 0xf4) { length = 4; high = 0x8f; } // nothing above U+10FFFF
+	else if (c >= 0xf1 && c <= 0xf3) length = 4;
+	else return 0;
+	if (i + length > text.size())
+		return 0;
+	unsigned char second = text[i + 1];
+	if (second < low || second > high)
+		return 0;
+	for (size_t j = 2; j < length; j++)
+		if ((static_cast<unsigned char>(text[i + j]) & 0xc0) != 0x80)
+			return 0;
+	return length;
+}
+
+void json_string(buffered_output& out, string_view text)
+{
+	const char* hex = "0123456789abcdef";
+	out << '"';
+	size_t plain = 0;
+	for (size_t i = 0; i < text.size(); i++) {
+		unsigned char c = text[i];
+		if (c >= 0x80) {
+			size_t length = utf8_length(text, i);
+			if (length) {
+				i += length - 1;
+				continue;
+			}
+		} else if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+		out << text.substr(plain, i - plain);
+		switch (c) {
+		case '"': out << "\\\""; break;
+		case '\\': out << "\\\\"; break;
+		case '\n': out << "\\n"; break;
+		case '\t': out << "\\t"; break;
+		default:
+			// a byte of no UTF-8 character becomes a lone low surrogate,
+			// as Python's surrogateescape does: os.fsencode() gives it back
+			out << (c >= 0x80 ? "\\udc" : "\\u00") << hex[c >> 4] << hex[c & 0xf];
+		}
+		plain = i + 1;
+	}
+	out << text.substr(plain) << '"';
+}
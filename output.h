@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+
+#include "compat.h"
+
+/* a large output buffer written with write(2) only when full,
+   instead of the per-line flushes of std::endl */
+class buffered_output
+{
+public:
+	explicit buffered_output(int fd = STDOUT_FILENO, size_t capacity = 1 << 20);
+	~buffered_output();
+	buffered_output(const buffered_output&) = delete;
+	buffered_output& operator=(const buffered_output&) = delete;
+
+	buffered_output& operator<<(std::string_view text);
+	buffered_output& operator<<(char c);
+	buffered_output& operator<<(uintmax_t number);
+	buffered_output& operator<<(long number);
+	buffered_output& operator<<(int number) { return *this << long(number); }
+	void flush();
+
+private:
+	int fd;
+	size_t capacity;
+	std::string buffer;
+};
+
+/* a quoted JSON string; file names need not be UTF-8, each byte that is
+   not part of a well-formed UTF-8 character is written as \udc80-\udcff
+   (Python's surrogateescape) so that the output stays valid JSON */
+void json_string(buffered_output& out, std::string_view text);
@@ -7,11 +7,28 @@
 #include <algorithm>
 #include <filesystem>
 
+#include "counters.h"
 #include "locate.h"
 #include "python.h"
 #include "read_ignores.h"
 
-int read_locate(vector<string>& fs, const string& ignore_path, const string& root_dir)
+// default PRUNEPATH in /etc/updatedb.conf
+static void read_spool(const path_sink& sink)
+{
+	sink("/var/spool");
+	try {
+		for (const auto& entry: filesystem::recursive_directory_iterator{"/var/spool", filesystem::directory_options::skip_permission_denied})
+		{
+			sink(entry.path().string());
+		}
+	} catch(const exception& e) {
+		cerr << "Failed to iterate directory /var/spool/: " << e.what() << endl;
+	}
+}
+
+/* plocate prints the database in updatedb order: a depth-first walk,
+   so all the files of a top-level directory come in one block */
+int scan_locate(const path_sink& sink, const string& ignore_path, const string&)
 {
 	bool debug=getenv("DEBUG") != nullptr;
 
@@ -22,23 +39,36 @@ int read_locate(vector<string>& fs, const string& ignore_path, const string& roo
 	vector<string> ignores;
 	read_ignores(ignores, ignore_path);
 
-	fs.emplace_back("/.");
-	fs.emplace_back("/dev");
-	fs.emplace_back("/home");
-	fs.emplace_back("/root");
-	fs.emplace_back("/tmp");
+	sink("/.");
+	sink("/dev");
+	sink("/home");
+	sink("/root");
+	sink("/tmp");
+
+	// /var/spool is inserted while the /var block is still open
+	bool in_var = false, spool = false;
 
 	char *buf = NULL;
 	size_t len = 0;
 	FILE* fp;
-	if ((fp = popen("plocate --null /", "r")) == nullptr) return 1;
+	count_op(op_exec);
+	if ((fp = popen("plocate --null /", "re")) == nullptr) return 1;
 	while (getdelim(&buf, &len, 0, fp) != -1)
 	{
 		auto len = strlen(buf);
+		count_op(op_pipe_bytes, len + 1);
+		count_op(op_paths);
 		if (len == 0)
 			continue;
 		string_view filename { buf, len };
 
+		bool now_var = filename.rfind("/var/", 0) == 0;
+		if (in_var && !now_var && !spool) {
+			read_spool(sink);
+			spool = true;
+		}
+		in_var = now_var;
+
 		auto toplevel { filename.substr(0, filename.find('/', 1)) };
 		if (   toplevel == "/dev"
 		    or (toplevel == "/home" /* and dirname != "/home" */)
@@ -66,24 +96,24 @@ int read_locate(vector<string>& fs, const string& ignore_path, const string& roo
 		if (ignored) continue;
 
 		if (!pyc_has_py(string{filename}, debug))
-			fs.emplace_back(filename);
+			sink(string{filename});
 	}
 	free(buf);
 	pclose(fp);
 
-	// default PRUNEPATH in /etc/updatedb.conf
-	fs.emplace_back("/var/spool");
-	try {
-		for (const auto& entry: filesystem::recursive_directory_iterator{"/var/spool", filesystem::directory_options::skip_permission_denied})
-		{
-			fs.emplace_back(entry.path());
-		}
-	} catch(const exception& e) {
-		cerr << "Failed to iterate directory /var/spool/: " << e.what() << endl;
-	}
+	if (!spool)
+		read_spool(sink);
+	return 0;
+}
+
+int read_locate(vector<string>& fs, const string& ignore_path, const string& root_dir)
+{
+	bool debug=getenv("DEBUG") != nullptr;
+
+	int rc = scan_locate([&fs](string&& path) { fs.emplace_back(std::move(path)); }, ignore_path, root_dir);
 
 	sort(fs.begin(), fs.end());
 	fs.erase( unique( fs.begin(), fs.end() ), fs.end() );
 	if (debug) cerr << fs.size() << " relevant files in PLOCATE database"  << endl << endl;
-	return 0;
+	return rc;
 }
@@ -0,0 +1,245 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "counters.h"
+#include "progress.h"
+
+using namespace std;
+
+/* a short text written by any thread and read by the reporter
+   without locks: the writers take turns through the odd sequence
+   numbers, the reader copies again when the number moved */
+class progress_label
+{
+public:
+	void set(const string& value)
+	{
+		unsigned seq = sequence.load(memory_order_relaxed) & ~1u;
+		while (!sequence.compare_exchange_weak(seq, seq + 1, memory_order_acquire, memory_order_relaxed))
+			seq &= ~1u;
+		size_t n = min(value.size(), sizeof(text) - 1);
+		for (size_t i = 0; i < n; i++)
+			text[i].store(value[i], memory_order_relaxed);
+		text[n].store('\0', memory_order_relaxed);
+		sequence.store(seq + 2, memory_order_release);
+	}
+
+	string get() const
+	{
+		for (;;) {
+			unsigned seq = sequence.load(memory_order_acquire);
+			if (seq & 1)
+				continue;
+			string value;
+			for (const auto& c: text) {
+				char ch = c.load(memory_order_relaxed);
+				if (!ch) break;
+				value += ch;
+			}
+			atomic_thread_fence(memory_order_acquire);
+			if (sequence.load(memory_order_relaxed) == seq)
+				return value;
+		}
+	}
+
+private:
+	atomic<unsigned> sequence{0};
+	atomic<char> text[160] = {};
+};
+
+// the running phases, each in the slot its thread took
+static const int phase_slots = 16;
+static progress_label phases[phase_slots];
+static atomic<bool> taken[phase_slots];
+static thread_local int phase_slot = -1;
+static progress_label where;
+
+static atomic<bool> dump_requested{false};
+static bool live = false;
+// the same line again and again, unless the report goes to the terminal too
+static bool overwrite = false;
+static string state_path;
+static map<string, double> previous;
+static chrono::steady_clock::time_point started;
+
+static mutex reporter_lock;
+static condition_variable wake;
+static bool stopping = false;
+static thread reporter;
+
+// the counts that tell how far a run is
+static const op_counter tracked[] = {op_paths, op_glob_calls, op_exec};
+
+static void on_sigusr1(int)
+{
+	dump_requested = true;
+}
+
+static string duration(double seconds)
+{
+	char buf[32];
+	long s = long(seconds);
+	if (s >= 3600)
+		snprintf(buf, sizeof(buf), "%ldh%02ldm", s / 3600, s / 60 % 60);
+	else
+		snprintf(buf, sizeof(buf), "%ldm%02lds", s / 60, s % 60);
+	return buf;
+}
+
+static void print(uint64_t last[op_counters], double& last_seconds)
+{
+	uint64_t ops[op_counters];
+	total_ops(ops);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+	double dt = seconds - last_seconds;
+	auto rate = [&](op_counter op) { return dt > 0 ? long((ops[op] - last[op]) / dt) : 0; };
+
+	string line = "cruft: " + duration(seconds);
+	vector<string> names;
+	for (int i = 0; i < phase_slots; i++) {
+		string name = taken[i] ? phases[i].get() : "";
+		if (!name.empty())
+			names.push_back(name);
+	}
+	if (!names.empty())
+		line += " " + names.front() + (names.size() > 1 ? " (+" + to_string(names.size() - 1) + ")" : "");
+	line += ", " + to_string(ops[op_paths]) + " paths (" + to_string(rate(op_paths)) + "/s)";
+	line += ", " + to_string(ops[op_glob_calls]) + " globs (" + to_string(rate(op_glob_calls)) + "/s)";
+	line += ", " + to_string(ops[op_exec]) + " scripts";
+	if (previous.count(op_name(op_exec)))
+		line += "/" + to_string(long(previous[op_name(op_exec)]));
+
+	// how far along, from where the previous run ended
+	double done = 0;
+	int known = 0;
+	for (auto op: tracked) {
+		auto prev = previous.find(op_name(op));
+		if (prev == previous.end() || prev->second <= 0)
+			continue;
+		done += min(1.0, ops[op] / prev->second);
+		known++;
+	}
+	if (known && done > 0) {
+		done /= known;
+		line += done < 1 ? ", ETA " + duration(seconds * (1 - done) / done) : ", ETA soon";
+	}
+	string at = where.get();
+	if (!at.empty())
+		line += ", " + at;
+
+	if (overwrite)
+		cerr << "\r\033[K" << line << flush;
+	else
+		cerr << line << '\n';
+
+	copy(ops, ops + op_counters, last);
+	last_seconds = seconds;
+}
+
+static void report()
+{
+	uint64_t last[op_counters] = {};
+	double last_seconds = 0;
+	auto next = chrono::steady_clock::now() + chrono::seconds(1);
+	unique_lock<mutex> lock(reporter_lock);
+	while (!stopping) {
+		wake.wait_for(lock, chrono::milliseconds(200));
+		bool due = live && chrono::steady_clock::now() >= next;
+		if (dump_requested.exchange(false) || due) {
+			print(last, last_seconds);
+			next = chrono::steady_clock::now() + chrono::seconds(1);
+		}
+	}
+	if (overwrite)
+		cerr << "\r\033[K" << flush;
+}
+
+void progress_start(bool live_, const string& state_file)
+{
+	live = live_;
+	overwrite = live && isatty(STDERR_FILENO) && !isatty(STDOUT_FILENO);
+	state_path = state_file;
+	started = chrono::steady_clock::now();
+
+	ifstream state(state_path);
+	string key;
+	double value;
+	while (state >> key >> value)
+		previous[key] = value;
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_sigusr1;
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &sa, nullptr);
+
+	reporter = thread(report);
+}
+
+void progress_end(bool save)
+{
+	if (!reporter.joinable())
+		return;
+	{
+		lock_guard<mutex> lock(reporter_lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	reporter.join();
+	signal(SIGUSR1, SIG_IGN);
+
+	if (!save || state_path.empty())
+		return;
+	uint64_t ops[op_counters];
+	total_ops(ops);
+	// best effort: without it there is just no ETA next time
+	string tmp = state_path + ".tmp";
+	{
+		ofstream state(tmp, ios::trunc);
+		state << "seconds " << chrono::duration<double>(chrono::steady_clock::now() - started).count() << '\n';
+		for (auto op: tracked)
+			state << op_name(op) << ' ' << ops[op] << '\n';
+		if (!state)
+			return;
+	}
+	if (rename(tmp.c_str(), state_path.c_str()) != 0)
+		unlink(tmp.c_str());
+}
+
+void progress_phase(const string& name, bool starting)
+{
+	if (starting) {
+		for (int i = 0; i < phase_slots; i++) {
+			bool free = false;
+			if (taken[i].compare_exchange_strong(free, true)) {
+				phases[i].set(name);
+				phase_slot = i;
+				break;
+			}
+		}
+	} else if (phase_slot >= 0) {
+		phases[phase_slot].set("");
+		taken[phase_slot] = false;
+		phase_slot = -1;
+	}
+}
+
+void progress_where(const string& what)
+{
+	where.set(what);
+}
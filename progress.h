@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+/* a line on stderr about a running cruft: the phase, the paths
+   scanned and the globs tried per second, the directory or explain
+   script at hand and an ETA from the counts of the previous run,
+   read from state_file; every second when live, else on SIGUSR1.
+   The numbers are the operation counters (counters.h), so the
+   workers only pay for the labels below */
+void progress_start(bool live, const std::string& state_file);
+// stops the reporter and, if save, writes this run's counts to the state file
+void progress_end(bool save);
+
+// a phase starting or ending on this thread
+void progress_phase(const std::string& name, bool starting);
+// the directory being scanned or the explain script being run
+void progress_where(const std::string& what);
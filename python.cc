@@ -7,6 +7,7 @@
 #include <dirent.h>
 #include <sys/stat.h>
 
+#include "counters.h"
 #include "python.h"
 
 #ifdef BUSTER
@@ -20,18 +21,24 @@ vector<string> versions;
 
 void init_python()
 {
-	DIR *dp;
-	struct dirent *dirp;
-	dp = opendir("/usr/bin");
-	while ((dirp = readdir(dp)) != nullptr) {
-		string entry { dirp->d_name };
-		if (entry.rfind("python3.") == 0 && entry.find("-") == string::npos) {
-			string pyc_ver = "3" + entry.substr(8);
-			versions.emplace_back(pyc_ver);
+	// several scanners may run in parallel, only fill 'versions' once
+	static const bool done = [] {
+		DIR *dp;
+		struct dirent *dirp;
+		count_op(op_opendir);
+		dp = opendir("/usr/bin");
+		while ((dirp = readdir(dp)) != nullptr) {
+			string entry { dirp->d_name };
+			if (entry.rfind("python3.") == 0 && entry.find("-") == string::npos) {
+				string pyc_ver = "3" + entry.substr(8);
+				versions.emplace_back(pyc_ver);
+			}
 		}
-	}
-	closedir(dp);
-	sort(versions.begin(), versions.end());
+		closedir(dp);
+		sort(versions.begin(), versions.end());
+		return true;
+	}();
+	(void) done;
 }
 
 static bool ends_with(string_view str, string_view suffix)
@@ -55,6 +62,7 @@ bool pyc_has_py(string pyc, bool debug)
 		DIR *dp;
 		struct dirent *dirp;
 		dir = pyc.substr(0, pyc.length()-12);
+		count_op(op_opendir);
 		dp = opendir(dir.c_str());
 		if(dp == nullptr) {
 			cerr << "Failed to open directory " << dir << ": " << strerror(errno) << endl;
@@ -84,7 +92,7 @@ bool pyc_has_py(string pyc, bool debug)
 	// python2 support
 	string py;
 	py = pyc.substr(0, pyc.length()-1);
-	if (stat(py.c_str(), &buffer) == 0) {
+	if (counted_stat(py.c_str(), &buffer) == 0) {
 		if (debug) cerr << "match: " << py << endl;
 		return true;
 	}
@@ -130,7 +138,7 @@ bool pyc_has_py(string pyc, bool debug)
 	pyc.replace(pos, offset, ".py");
 
 	bool matched;
-	matched = (stat(pyc.c_str(), &buffer) == 0);
+	matched = (counted_stat(pyc.c_str(), &buffer) == 0);
 	if (matched && debug) cerr << "match: " << pyc << endl;
 	return matched;
 }
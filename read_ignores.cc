@@ -3,6 +3,7 @@
 
 #include <fstream>
 
+#include "counters.h"
 #include "read_ignores.h"
 
 void read_ignores(vector<string>& ignores, const string& ignore_path)
@@ -13,6 +14,7 @@ void read_ignores(vector<string>& ignores, const string& ignore_path)
 
 	for (string ignore_line; getline(ignore_file,ignore_line);)
 	{
+		count_op(op_file_bytes, ignore_line.size() + 1);
 		if (ignore_line.empty()) continue;
 		if (ignore_line.front() == '/') {
 			if (ignore_line.back() != '/')
@@ -0,0 +1,465 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "columns.h"
+#include "counters.h"
+#include "metrics.h"
+#include "output.h"
+#include "report.h"
+
+using namespace std;
+
+static report_format format = report_format::text;
+static buffered_output out;
+
+// JSON punctuation state
+static bool first_section = true;
+static bool first_entry = true;
+
+static vector<pair<string, uintmax_t>> counts;
+static uintmax_t missing_total = 0;
+static uintmax_t unexplained_total = 0;
+
+static string root_dir = "/";
+static bool as_root = false;
+static string export_file;
+static unique_ptr<column_writer> exported;
+static string metrics_file;
+static unique_ptr<metrics_writer> metrics;
+
+// --delta: the sections are only collected, and compared at the end
+static string delta_file;
+static bool quiet = false;
+// the entries printed again by the comparison are already counted
+static bool comparing = false;
+static known_bugs* delta_bugs = nullptr;
+
+bool parse_report_format(const string& name, report_format& format)
+{
+	if (name == "text")
+		format = report_format::text;
+	else if (name == "json")
+		format = report_format::json;
+	else if (name == "ndjson")
+		format = report_format::ndjson;
+	else
+		return false;
+	return true;
+}
+
+static void json_field(const char* key, const string& value)
+{
+	out << ",\"" << key << "\":";
+	json_string(out, value);
+}
+
+void report_start(report_format format_, const report_origin& origin)
+{
+	format = format_;
+	root_dir = origin.root_dir;
+	as_root = origin.as_root;
+	if (format == report_format::text) {
+		out << "cruft report: " << origin.date << '\n';
+	} else {
+		out << (format == report_format::json ? "{\"report\":\"cruft\"" : "{\"type\":\"start\"");
+		out << ",\"version\":1";
+		json_field("date", origin.date);
+		json_field("host", origin.host);
+		json_field("root", origin.root_dir);
+		json_field("backend", origin.backend);
+		json_field("mode", origin.mode);
+		json_field("ruleset", origin.ruleset_file);
+		json_field("filters", origin.filter_dir);
+		json_field("explain", origin.explain_dir);
+		json_field("bugs", origin.bugs_file);
+		out << (format == report_format::json ? ",\"sections\":[" : "}\n");
+	}
+	// the scan takes a while, show at least that something started
+	out.flush();
+}
+
+void report_export(const string& file)
+{
+	export_file = file;
+	exported.reset(new column_writer);
+}
+
+void report_metrics(const string& file, function<string(const string&)> mount_of)
+{
+	metrics_file = file;
+	metrics.reset(new metrics_writer(std::move(mount_of)));
+}
+
+void report_delta(const string& snapshot)
+{
+	delta_file = snapshot;
+	quiet = true;
+	if (!exported)
+		exported.reset(new column_writer);
+}
+
+// the file type and size of an unexplained path, a folded directory has the size of its content
+static void entry_stat(const string& path, const collapsed* folded, char& type, uint64_t& size)
+{
+	type = '?';
+	size = 0;
+	if (folded && folded->count) {
+		type = 'd';
+		size = folded->size;
+		return;
+	}
+	struct stat st;
+	string real = root_dir + path.substr(1);
+	if (counted_lstat(real.c_str(), &st) != 0)
+		return;
+	if (S_ISLNK(st.st_mode)) {
+		type = 'l';
+		size = st.st_size;
+	} else if (S_ISDIR(st.st_mode)) {
+		type = 'd';
+	} else {
+		type = 'f';
+		size = st.st_size;
+	}
+}
+
+static void begin_section(const char* type, const string& section, bool checked = true)
+{
+	if (quiet)
+		return;
+	switch (format) {
+	case report_format::text:
+		out << "---- " << type << ": " << section << " ----\n";
+		break;
+	case report_format::json:
+		out << (first_section ? "\n{\"type\":" : ",\n{\"type\":");
+		json_string(out, type);
+		json_field("section", section);
+		if (!checked) out << ",\"checked\":false";
+		out << ",\"entries\":[";
+		first_section = false;
+		first_entry = true;
+		break;
+	case report_format::ndjson:
+		break;
+	}
+}
+
+static void end_section()
+{
+	if (!quiet && format == report_format::json)
+		out << "]}";
+}
+
+static void print_entry(const char* type, const string& section, const string& path,
+                        const bug* known = nullptr, const collapsed* folded = nullptr)
+{
+	if (format == report_format::text) {
+		out << "        " << path;
+		if (folded && folded->count)
+			out << "/**       (" << folded->count << " entries, " << folded->size << " bytes)";
+		if (known)
+			out << "       (Bug: #" << known->bugno << ")";
+		out << '\n';
+		return;
+	}
+
+	if (format == report_format::json) {
+		out << (first_entry ? "\n{\"path\":" : ",\n{\"path\":");
+		first_entry = false;
+	} else {
+		out << "{\"type\":";
+		json_string(out, type);
+		json_field("section", section);
+		out << ",\"path\":";
+	}
+	json_string(out, path);
+	if (folded && folded->count)
+		out << ",\"entries\":" << folded->count << ",\"bytes\":" << folded->size;
+	if (known) {
+		json_field("bug", known->bugno);
+		json_field("package", known->package);
+	}
+	out << (format == report_format::json ? "}" : "}\n");
+}
+
+static void one_entry(const char* type, const string& section, const string& path,
+                      known_bugs* bugs = nullptr, const collapsed* folded = nullptr)
+{
+	bug found("", "");
+	const bug* known = bugs && bugs->find(path, found) ? &found : nullptr;
+	bool counted = metrics && !comparing;
+	if (exported || counted) {
+		uint8_t verdict = type[0] == 'm' ? verdict_missing : verdict_unexplained;
+		char file_type = '?';
+		uint64_t size = 0;
+		if (verdict == verdict_unexplained)
+			entry_stat(path, folded, file_type, size);
+		if (exported)
+			exported->add(path, known ? known->package : "", file_type, verdict, size);
+		if (counted)
+			metrics->add(path, verdict, size);
+	}
+	if (!quiet)
+		print_entry(type, section, path, known, folded);
+}
+
+void report_missing(const vector<string>& missing2)
+{
+	//TODO: some smarter algo when run as non-root
+        //      like checking the R/X bits of parent dir
+	bool checked = as_root;
+	begin_section("missing", "dpkg", checked);
+	if (checked) for (const auto& miss: missing2) {
+		one_entry("missing", "dpkg", miss);
+		missing_total++;
+	}
+	end_section();
+}
+
+void report_unexplained(const string& section, const vector<string>& cruft4, known_bugs& bugs)
+{
+	delta_bugs = &bugs;
+	begin_section("unexplained", section);
+	for (const auto& cr: cruft4)
+		one_entry("unexplained", section, cr, &bugs);
+	unexplained_total += cruft4.size();
+	end_section();
+}
+
+void report_unexplained(const string& section, const function<bool(string&)>& next, known_bugs& bugs)
+{
+	delta_bugs = &bugs;
+	begin_section("unexplained", section);
+	for (string cr; next(cr);) {
+		one_entry("unexplained", section, cr, &bugs);
+		unexplained_total++;
+	}
+	end_section();
+}
+
+void report_unexplained(const string& section, const vector<collapsed>& cruft4, known_bugs& bugs)
+{
+	delta_bugs = &bugs;
+	begin_section("unexplained", section);
+	for (const auto& cr: cruft4)
+		one_entry("unexplained", section, cr.path, &bugs, &cr);
+	unexplained_total += cruft4.size();
+	end_section();
+}
+
+void report_not_covered(const string& section, const vector<string>& paths)
+{
+	if (paths.empty())
+		return;
+	begin_section("not covered", section);
+	if (!quiet) for (const auto& path: paths)
+		print_entry("not covered", section, path);
+	end_section();
+	counts.emplace_back("not covered " + section, paths.size());
+}
+
+static void print_figure(const char* name, const estimate_figure& figure)
+{
+	if (format == report_format::text) {
+		out << "        " << name << ' ' << uintmax_t(llround(figure.value))
+		    << " +/- " << uintmax_t(llround(figure.margin())) << '\n';
+	} else {
+		out << ",\"" << name << "\":" << uintmax_t(llround(figure.value))
+		    << ",\"" << name << "_margin\":" << uintmax_t(llround(figure.margin()));
+	}
+}
+
+void report_estimate(const estimate_totals& totals)
+{
+	switch (format) {
+	case report_format::text:
+		out << "---- estimate: " << totals.section << " ----\n";
+		break;
+	case report_format::json:
+		out << (first_section ? "\n{\"type\":\"estimate\"" : ",\n{\"type\":\"estimate\"");
+		first_section = false;
+		json_field("section", totals.section);
+		break;
+	case report_format::ndjson:
+		out << "{\"type\":\"estimate\"";
+		json_field("section", totals.section);
+		break;
+	}
+	print_figure("entries", totals.entries);
+	print_figure("unexplained", totals.unexplained);
+	print_figure("bytes", totals.bytes);
+	if (format != report_format::text)
+		out << (format == report_format::json ? "}" : "}\n");
+	if (metrics)
+		metrics->estimate(totals);
+}
+
+void report_count(const string& name, uintmax_t value)
+{
+	counts.emplace_back(name, value);
+}
+
+void report_flush()
+{
+	out.flush();
+}
+
+/* compare the snapshot of the previous run, if any, with this one
+   and replace it; both are sorted by path so this is a single merge */
+static bool report_changes()
+{
+	column_reader previous;
+	bool has_previous = access(delta_file.c_str(), F_OK) == 0 && previous.open(delta_file);
+	// missing files are only checked as root, comparing with a run
+	// of the other kind would report all of them as new or gone
+	if (has_previous && bool(previous.flags() & column_as_root) != as_root) {
+		cerr << delta_file << ": the previous run was " << (as_root ? "not " : "")
+		     << "as root, starting over from this one\n";
+		has_previous = false;
+	}
+	// the previous snapshot stays mapped once replaced
+	column_reader current;
+	if (!exported->write(delta_file) || !current.open(delta_file))
+		return false;
+
+	vector<string> added[2], gone[2]; // unexplained, missing
+	auto index = [](const column_row& row) { return row.verdict == verdict_missing ? 1 : 0; };
+	column_row old_row, new_row;
+	bool has_old = has_previous && previous.next(old_row);
+	bool has_new = current.next(new_row);
+	while (has_old || has_new) {
+		if (has_old && has_new && old_row.path == new_row.path) {
+			if (old_row.verdict != new_row.verdict) {
+				gone[index(old_row)].push_back(old_row.path);
+				added[index(new_row)].push_back(new_row.path);
+			}
+			has_old = previous.next(old_row);
+			has_new = current.next(new_row);
+		} else if (has_new && (!has_old || new_row.path < old_row.path)) {
+			added[index(new_row)].push_back(new_row.path);
+			has_new = current.next(new_row);
+		} else {
+			gone[index(old_row)].push_back(old_row.path);
+			has_old = previous.next(old_row);
+		}
+	}
+
+	exported.reset();
+	quiet = false;
+	comparing = true;
+	const char* types[2] = {"unexplained", "missing"};
+	for (int i = 0; i < 2; i++) {
+		begin_section(types[i], "new");
+		for (const auto& path: added[i])
+			one_entry(types[i], "new", path, i == 0 ? delta_bugs : nullptr);
+		end_section();
+		begin_section(types[i], "gone");
+		for (const auto& path: gone[i])
+			one_entry(types[i], "gone", path);
+		end_section();
+		counts.emplace_back(string("new ") + types[i], added[i].size());
+		counts.emplace_back(string("gone ") + types[i], gone[i].size());
+	}
+	return true;
+}
+
+// the operation counters that are not zero, as JSON members
+static void json_ops(const uint64_t ops[op_counters], bool first = true)
+{
+	for (int i = 0; i < op_counters; i++) {
+		if (!ops[i]) continue;
+		out << (first ? "" : ",") << '"' << op_name(i) << "\":" << ops[i];
+		first = false;
+	}
+}
+
+static void print_ops(const vector<phase_timing>& timings, const uint64_t total[op_counters])
+{
+	cerr << "operations:\n";
+	for (const auto& timing: timings) {
+		cerr << "  " << timing.name << ':';
+		for (int i = 0; i < op_counters; i++)
+			if (timing.ops[i])
+				cerr << ' ' << op_name(i) << '=' << timing.ops[i];
+		cerr << '\n';
+	}
+	cerr << "  total:";
+	for (int i = 0; i < op_counters; i++)
+		cerr << ' ' << op_name(i) << '=' << total[i];
+	cerr << '\n';
+}
+
+bool report_end(const vector<phase_timing>& timings)
+{
+	bool written = true;
+	if (exported)
+		exported->set_flags(as_root ? uint32_t(column_as_root) : 0);
+	if (exported && !export_file.empty())
+		written = exported->write(export_file);
+	if (!delta_file.empty())
+		written = report_changes() && written;
+
+	counts.emplace_back("missing", missing_total);
+	counts.emplace_back("unexplained", unexplained_total);
+
+	// also what was done outside of the phases
+	uint64_t total[op_counters];
+	total_ops(total);
+	if (getenv("ELAPSED") || getenv("DEBUG"))
+		print_ops(timings, total);
+	if (metrics)
+		written = metrics->write(metrics_file, counts, timings, total) && written;
+
+	switch (format) {
+	case report_format::text:
+		out << "\nend.\n";
+		break;
+	case report_format::json:
+		out << "\n],\"counts\":{";
+		for (size_t i = 0; i < counts.size(); i++) {
+			if (i) out << ',';
+			json_string(out, counts[i].first);
+			out << ':' << counts[i].second;
+		}
+		out << "},\"phases\":[";
+		for (size_t i = 0; i < timings.size(); i++) {
+			out << (i ? ",\n{\"name\":" : "\n{\"name\":");
+			json_string(out, timings[i].name);
+			out << ",\"start_ms\":" << timings[i].start_ms << ",\"ms\":" << timings[i].ms;
+			out << ",\"cpu_ms\":" << timings[i].cpu_ms << ",\"ops\":{";
+			json_ops(timings[i].ops);
+			out << "}}";
+		}
+		out << "\n],\"operations\":{";
+		json_ops(total);
+		out << "}}\n";
+		break;
+	case report_format::ndjson:
+		for (const auto& count: counts) {
+			out << "{\"type\":\"count\",\"name\":";
+			json_string(out, count.first);
+			out << ",\"value\":" << count.second << "}\n";
+		}
+		for (const auto& timing: timings) {
+			out << "{\"type\":\"phase\",\"name\":";
+			json_string(out, timing.name);
+			out << ",\"start_ms\":" << timing.start_ms << ",\"ms\":" << timing.ms;
+			out << ",\"cpu_ms\":" << timing.cpu_ms << ",\"ops\":{";
+			json_ops(timing.ops);
+			out << "}}\n";
+		}
+		out << "{\"type\":\"operations\"";
+		json_ops(total, false);
+		out << "}\n{\"type\":\"end\"}\n";
+		break;
+	}
+	out.flush();
+	return written;
+}
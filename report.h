@@ -0,0 +1,54 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bugs.h"
+#include "collapse.h"
+#include "estimate.h"
+#include "scheduler.h"
+
+enum class report_format { text, json, ndjson };
+
+// where a report comes from, only written by the structured formats
+struct report_origin
+{
+	std::string date;
+	std::string host;
+	std::string root_dir;
+	std::string backend;
+	std::string mode;
+	std::string ruleset_file;
+	std::string filter_dir;
+	std::string explain_dir;
+	std::string bugs_file;
+	// the missing files can only be told apart from unreadable ones as root
+	bool as_root = false;
+};
+
+bool parse_report_format(const std::string& name, report_format& format);
+
+void report_start(report_format format, const report_origin& origin);
+// also write the reported paths to a binary export, see columns.h
+void report_export(const std::string& file);
+// also write the figures of the run to this file for Prometheus, see metrics.h
+void report_metrics(const std::string& file, std::function<std::string(const std::string&)> mount_of);
+// only print what changed since the snapshot left in this file by the previous run
+void report_delta(const std::string& snapshot);
+void report_missing(const std::vector<std::string>& missing2);
+void report_unexplained(const std::string& section, const std::vector<std::string>& cruft4, known_bugs& bugs);
+// same, for lists that are not kept in memory
+void report_unexplained(const std::string& section, const std::function<bool(std::string&)>& next, known_bugs& bugs);
+// same, with the fully unexplained directories folded
+void report_unexplained(const std::string& section, const std::vector<collapsed>& cruft4, known_bugs& bugs);
+// what a --deadline run did not get to, neither exported nor part of the totals
+void report_not_covered(const std::string& section, const std::vector<std::string>& paths);
+// the figures of --estimate for a top-level directory or the total, with their 95% margins
+void report_estimate(const estimate_totals& totals);
+// a figure for the structured formats, ignored in the text report
+void report_count(const std::string& name, uintmax_t value);
+// write out what is buffered so far, for the modes that print sections as they go
+void report_flush();
+// false if the export or the snapshot could not be written
+bool report_end(const std::vector<phase_timing>& timings);
@@ -0,0 +1,87 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <map>
+#include <time.h>
+
+#include "progress.h"
+#include "scheduler.h"
+#include "trace.h"
+
+using namespace std;
+
+static long thread_cpu_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+void scheduler::add(const string& name, const vector<string>& deps, function<void()> task)
+{
+	phases.push_back({name, deps, std::move(task)});
+}
+
+void scheduler::run()
+{
+	auto start = chrono::steady_clock::now();
+
+	// phases may be declared in any order, start them in a topological one
+	vector<size_t> order;
+	map<string, bool> ready;
+	while (order.size() < phases.size()) {
+		size_t before = order.size();
+		for (size_t i = 0; i < phases.size(); i++) {
+			if (ready.count(phases[i].name)) continue;
+			if (all_of(phases[i].deps.begin(), phases[i].deps.end(),
+			           [&ready](const string& dep) { return ready.count(dep); })) {
+				ready[phases[i].name] = true;
+				order.push_back(i);
+			}
+		}
+		if (order.size() == before) {
+			for (const auto& p: phases)
+				if (!ready.count(p.name))
+					cerr << "phase " << p.name << " has an unknown or circular dependency\n";
+			exit(1);
+		}
+	}
+
+	map<string, shared_future<void>> done;
+	for (auto i: order) {
+		auto& p = phases[i];
+		vector<shared_future<void>> deps;
+		for (const auto& dep: p.deps)
+			deps.push_back(done[dep]);
+
+		done[p.name] = async(launch::async, [this, &p, deps, start] {
+			for (const auto& dep: deps)
+				dep.get();
+			uint64_t before[op_counters];
+			thread_ops(before);
+			auto beg = chrono::steady_clock::now();
+			long cpu = thread_cpu_ms();
+			{
+				trace_span span(p.name);
+				progress_phase(p.name, true);
+				p.task();
+				progress_phase(p.name, false);
+			}
+			auto end = chrono::steady_clock::now();
+			auto ms = [](auto d) { return long(chrono::duration_cast<chrono::milliseconds>(d).count()); };
+			phase_timing timing{p.name, ms(beg - start), ms(end - beg), thread_cpu_ms() - cpu, {}};
+			thread_ops(timing.ops);
+			for (int i = 0; i < op_counters; i++)
+				timing.ops[i] -= before[i];
+			lock_guard<mutex> lock(finished_lock);
+			finished.push_back(timing);
+		}).share();
+	}
+
+	for (const auto& d: done)
+		d.second.get();
+}
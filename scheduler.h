@@ -0,0 +1,43 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "counters.h"
+
+struct phase_timing
+{
+	std::string name;
+	long start_ms;
+	long ms;
+	long cpu_ms;                 // of the thread of the phase
+	uint64_t ops[op_counters];   // done by the thread of the phase
+};
+
+/* a tiny task graph: each phase starts as soon as
+   all the phases it depends on are finished */
+class scheduler
+{
+public:
+	void add(const std::string& name, const std::vector<std::string>& deps, std::function<void()> task);
+	void run();
+	// in completion order, filled in by run(); may be called while it runs
+	std::vector<phase_timing> timings() const
+	{
+		std::lock_guard<std::mutex> lock(finished_lock);
+		return finished;
+	}
+
+private:
+	struct phase
+	{
+		std::string name;
+		std::vector<std::string> deps;
+		std::function<void()> task;
+	};
+	std::vector<phase> phases;
+	std::vector<phase_timing> finished;
+	mutable std::mutex finished_lock;
+};
@@ -1,3 +1,4 @@
+#include "counters.h"
 #include "shellexp.h"
 
 using namespace std;
@@ -47,15 +48,19 @@ using namespace std;
 */
 bool myglob(const string& file, const string& glob )
 {
+	count_op(op_glob_calls);
 	bool result=shellexp(file.c_str(), glob.c_str());
 	return result;
 }
 
 /* this is the original function from original "cruft" project */
 
-/* 0 on no match, non-zero on match */
-int shellexp(const char* string_, const char* pattern ) {
+/* 0 on no match, non-zero on match;
+   'steps' counts the calls, added to op_glob_steps once per match
+   by shellexp(): this is the hottest loop of the rule matching */
+static int match(const char* string_, const char* pattern, uint64_t& steps) {
     /*  printf( "...matching( \"%s\", \"%s\" )\n", string, pattern ); */
+    steps++;
 
     switch( pattern[0] ) {
     case '\0':
@@ -66,7 +71,7 @@ int shellexp(const char* string_, const char* pattern ) {
 	case '/':
 	    return false;
 	default:
-	    return shellexp( string_+1, pattern+1 );
+	    return match( string_+1, pattern+1, steps );
 	}
     case '/':
 	if ( pattern[1] == '*' && pattern[2] == '*' ) {
@@ -79,7 +84,7 @@ int shellexp(const char* string_, const char* pattern ) {
 	    if ( pattern[3] == '\0' ) return true;
 	    while ( *pch != '\0' ) {
 		if ( *pch == '/' ) {
-		    int ret = shellexp( pch, pattern + 3 );
+		    int ret = match( pch, pattern + 3, steps );
 		    if ( ret == true || ret == -1 )
 		    	return ret;
 		}
@@ -87,15 +92,15 @@ int shellexp(const char* string_, const char* pattern ) {
 	    }
 	    return false;
 	} else if ( string_[0] == '/' ) {
-		return shellexp( string_+1, pattern+1 );
+		return match( string_+1, pattern+1, steps );
 	} else
 		return false;
     case '*':
-	if ( string_[0] == '/' ) return shellexp( string_, pattern+1 );
+	if ( string_[0] == '/' ) return match( string_, pattern+1, steps );
 	{
-		int ret = shellexp( string_, pattern+1 );
+		int ret = match( string_, pattern+1, steps );
 		if (ret == false)
-			return string_[0] != '\0' ? shellexp( string_ + 1, pattern ) : false;
+			return string_[0] != '\0' ? match( string_ + 1, pattern, steps ) : false;
 		else
 			return ret;
 	}
@@ -103,7 +108,15 @@ int shellexp(const char* string_, const char* pattern ) {
 	if (pattern[0] != string_[0])
 		return false;
 	else
-		return shellexp( string_ + 1, pattern + 1 );
+		return match( string_ + 1, pattern + 1, steps );
     }
 }
 
+
+int shellexp(const char* string_, const char* pattern)
+{
+	uint64_t steps = 0;
+	int result = match(string_, pattern, steps);
+	count_op(op_glob_steps, steps);
+	return result;
+}
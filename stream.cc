@@ -0,0 +1,54 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <iostream>
+
+#include "stream.h"
+
+using namespace std;
+
+string shard_of(const string& path)
+{
+	auto slash = path.find('/', 1);
+	if (slash == string::npos)
+		return "/";
+	return path.substr(0, slash);
+}
+
+void shard_builder::flush(shard& s)
+{
+	sort(s.paths.begin(), s.paths.end());
+	s.paths.erase( unique( s.paths.begin(), s.paths.end() ), s.paths.end() );
+	queue.push(std::move(s));
+	s = shard();
+}
+
+void shard_builder::add(string&& path)
+{
+	auto name = shard_of(path);
+	if (name == "/") {
+		root.paths.emplace_back(std::move(path));
+		return;
+	}
+	if (name != current.name) {
+		if (!current.paths.empty()) {
+			queued.insert(current.name);
+			flush(current);
+		}
+		if (queued.count(name)) {
+			cerr << "the scan came back to " << name << ", which is already reported; run without --stream\n";
+			exit(1);
+		}
+		current.name = name;
+	}
+	current.paths.emplace_back(std::move(path));
+}
+
+void shard_builder::finish()
+{
+	if (!current.paths.empty())
+		flush(current);
+	flush(root);
+	queue.close();
+}
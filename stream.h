@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// all the files below one top-level directory,
+// the shard named "/" holds the top-level entries themselves
+struct shard
+{
+	std::string name;
+	std::vector<std::string> paths;
+	std::vector<std::string> missing;
+};
+
+// "/usr/bin/ls" -> "/usr", "/usr" -> "/"
+std::string shard_of(const std::string& path);
+
+// a blocking FIFO holding at most 'capacity' items
+template <typename T>
+class bounded_queue
+{
+public:
+	explicit bounded_queue(size_t capacity) : capacity(capacity) {}
+
+	void push(T&& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [this] { return items.size() < capacity; });
+		items.emplace_back(std::move(item));
+		not_empty.notify_one();
+	}
+
+	// returns false once the queue is closed and drained
+	bool pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [this] { return !items.empty() || closed; });
+		if (items.empty())
+			return false;
+		item = std::move(items.front());
+		items.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_empty.notify_all();
+	}
+
+private:
+	size_t capacity;
+	bool closed = false;
+	std::deque<T> items;
+	std::mutex mutex;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+};
+
+/* cuts the output of a scanner in shards,
+   each shard is sorted and queued as soon as the scanner moves on
+   to the next top-level directory; a directory coming back once its
+   shard is queued, e.g. from an unsorted locate database, would be
+   matched twice against its dpkg slice, so that stops the run */
+class shard_builder
+{
+public:
+	explicit shard_builder(bounded_queue<shard>& queue) : queue(queue) {}
+	void add(std::string&& path);
+	// flush the last shard and the top-level entries, then close the queue
+	void finish();
+
+private:
+	void flush(shard& s);
+	bounded_queue<shard>& queue;
+	shard current;
+	shard root { "/", {}, {} };
+	std::set<std::string> queued;
+};
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <random>
+#include <map>
+#include <unistd.h>
+#include "columns.h"
+
+#define GREEN "\033[1;32m"
+#define RED "\033[1;31m"
+#define BLACK "\033[0m"
+
+using namespace std;
+
+struct expected_row
+{
+	string package;
+	char type;
+	uint8_t verdict;
+	uint64_t size;
+};
+
+void test(int count)
+{
+	cout << "exporting " << count << " rows" << endl;
+	mt19937 random(count);
+	map<string, expected_row> expected;
+	column_writer writer;
+	for (int i = 0; i < count; i++) {
+		string path = "/var/lib/" + to_string(random() % 500) + "/file" + to_string(random() % 9);
+		string package = random() % 3 ? "package" + to_string(random() % 20) : "";
+		expected_row row{package, "fld?"[random() % 4], uint8_t(random() % 4), random() * uint64_t(random())};
+		if (!expected.count(path))
+			expected[path] = row;
+		writer.add(path, package, row.type, row.verdict, row.size);
+	}
+
+	char file[] = "/tmp/test_columns.XXXXXX";
+	close(mkstemp(file));
+	bool ok = writer.write(file);
+
+	column_reader reader;
+	ok = ok && reader.open(file);
+	ok = ok && reader.rows() == expected.size();
+
+	// sequential
+	auto it = expected.begin();
+	column_row row;
+	while (ok && reader.next(row)) {
+		ok = it != expected.end() && row.path == it->first && row.package == it->second.package
+		     && row.type == it->second.type && row.verdict == it->second.verdict && row.size == it->second.size;
+		it++;
+	}
+	ok = ok && it == expected.end();
+
+	// random access
+	it = expected.begin();
+	for (uint64_t i = 0; ok && i < reader.rows(); i++, it++)
+		ok = reader.path(i) == it->first && reader.package(i) == it->second.package;
+
+	unlink(file);
+	if (ok) {
+		cout << GREEN << "OK" << BLACK << endl << endl;
+	} else {
+		cout << RED << "ERROR" << BLACK << endl << endl;
+	};
+}
+
+int main()
+{
+	test(0);
+	test(1);
+	test(20000);
+}
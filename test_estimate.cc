@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include "estimate.h"
+
+#define GREEN "\033[1;32m"
+#define RED "\033[1;31m"
+#define BLACK "\033[0m"
+
+using namespace std;
+
+// a random tree: each directory holds some files and up to 'fanout' subdirectories
+struct tree
+{
+	map<string, vector<string>> entries;
+	map<string, vector<string>> subdirs;
+	vector<string> unexplained;
+	double total_unexplained = 0;
+	double total_bytes = 0;
+
+	tree(int depth, int fanout, unsigned seed)
+	{
+		mt19937 random(seed);
+		grow("/", 0, depth, fanout, random);
+		sort(unexplained.begin(), unexplained.end());
+	}
+
+	static uint64_t size(const string& path)
+	{
+		return path.size() * 100;
+	}
+
+	void grow(const string& dir, int level, int depth, int fanout, mt19937& random)
+	{
+		string prefix = dir == "/" ? "" : dir;
+		auto& here = entries[dir];
+		subdirs[dir];
+		int files = random() % 20;
+		for (int i = 0; i < files; i++) {
+			string file = prefix + "/file" + to_string(i);
+			here.push_back(file);
+			// some directories hold much more cruft than others
+			if (random() % (level + 2) == 0) {
+				unexplained.push_back(file);
+				total_unexplained++;
+				total_bytes += size(file);
+			}
+		}
+		if (level == depth)
+			return;
+		int n = random() % (fanout + 1);
+		for (int i = 0; i < n; i++) {
+			string sub = prefix + "/dir" + to_string(i);
+			here.push_back(sub);
+			subdirs[dir].push_back(sub);
+			grow(sub, level + 1, depth, fanout, random);
+		}
+	}
+
+	void list(const string& dir, vector<string>& e, vector<string>& s) const
+	{
+		e = entries.at(dir);
+		s = subdirs.at(dir);
+	}
+};
+
+static void check(bool ok)
+{
+	if (ok) {
+		cout << GREEN << "OK" << BLACK << endl << endl;
+	} else {
+		cout << RED << "ERROR" << BLACK << endl << endl;
+	};
+}
+
+// the shallow part is listed in full: no sampling error
+void test_exact()
+{
+	cout << "tree no deeper than the exact part" << endl;
+	tree t(estimate_exact_depth, 5, 1);
+	auto list = [&t](const string& dir, vector<string>& e, vector<string>& s) { t.list(dir, e, s); };
+	tree_sample sample(list, 100, 1);
+	vector<estimate_totals> totals;
+	sample.estimate(t.unexplained, tree::size, totals);
+	const auto& total = totals.back();
+	cout << total.unexplained.value << " unexplained, expected " << t.total_unexplained << endl;
+	check(sample.walks() == 0 && total.unexplained.value == t.total_unexplained
+	      && total.bytes.value == t.total_bytes && total.unexplained.margin() == 0);
+}
+
+// the 95% intervals hold the real figure most of the time
+void test_coverage()
+{
+	cout << "coverage of the confidence intervals" << endl;
+	tree t(8, 5, 2);
+	auto list = [&t](const string& dir, vector<string>& e, vector<string>& s) { t.list(dir, e, s); };
+	int runs = 200, covered = 0;
+	double sum = 0;
+	size_t listed = 0;
+	for (int seed = 0; seed < runs; seed++) {
+		tree_sample sample(list, 100, seed);
+		vector<estimate_totals> totals;
+		sample.estimate(t.unexplained, tree::size, totals);
+		const auto& total = totals.back();
+		if (fabs(total.unexplained.value - t.total_unexplained) <= total.unexplained.margin())
+			covered++;
+		sum += total.unexplained.value;
+		listed += sample.listed();
+	}
+	double mean = sum / runs;
+	cout << t.entries.size() << " directories, " << listed / runs << " listed per run" << endl;
+	cout << "mean estimate " << mean << ", expected " << t.total_unexplained << endl;
+	cout << covered << " of " << runs << " intervals hold it" << endl;
+	check(covered >= runs * 85 / 100 && fabs(mean - t.total_unexplained) < 0.05 * t.total_unexplained
+	      && listed / runs < t.entries.size());
+}
+
+int main()
+{
+	test_exact();
+	test_coverage();
+}
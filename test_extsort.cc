@@ -0,0 +1,63 @@
+#include <iostream>
+#include <random>
+#include <set>
+#include <dirent.h>
+#include "extsort.h"
+
+#define GREEN "\033[1;32m"
+#define RED "\033[1;31m"
+#define BLACK "\033[0m"
+
+using namespace std;
+
+// the runs still open, with stdin, stdout, stderr and the one opendir() uses
+static size_t open_files()
+{
+	size_t n = 0;
+	DIR* dp = opendir("/proc/self/fd");
+	while (readdir(dp) != nullptr)
+		n++;
+	closedir(dp);
+	return n - 2; // . and ..
+}
+
+void test(size_t max_bytes)
+{
+	cout << "sorting with " << max_bytes << " bytes of memory" << endl;
+	mt19937 random(max_bytes);
+	set<string> expected;
+	external_sorter sorter(max_bytes);
+	for (int i = 0; i < 20000; i++) {
+		string path = "/usr/share/doc/" + to_string(random() % 5000) + "/file" + to_string(random() % 7);
+		expected.insert(path);
+		sorter.add(std::move(path));
+	}
+	sorter.finish();
+	size_t open = open_files();
+	cout << sorter.runs() << " runs, " << open << " files open" << endl;
+
+	auto it = expected.begin();
+	string path;
+	bool ok = true;
+	while (sorter.next(path)) {
+		if (it == expected.end() || *it != path) {
+			ok = false;
+			break;
+		}
+		it++;
+	}
+	// the runs are merged 64 at a time
+	ok = ok && it == expected.end() && open < 3 * 64;
+	if (ok) {
+		cout << GREEN << "OK" << BLACK << endl << endl;
+	} else {
+		cout << RED << "ERROR" << BLACK << endl << endl;
+	};
+}
+
+int main()
+{
+	test(100 << 20);
+	test(64 << 10);
+	test(1000);
+}
@@ -0,0 +1,55 @@
+#include <iostream>
+#include <unistd.h>
+#include "match.h"
+#include "memo.h"
+
+#define GREEN "\033[1;32m"
+#define RED "\033[1;31m"
+#define BLACK "\033[0m"
+
+using namespace std;
+
+int main()
+{
+	vector<owner> globs = {{"foo", "/var/lib/foo/**"}, {"bar", "/etc/bar.conf"}};
+	vector<string> cruft = {"/etc", "/etc/bar.conf", "/etc/baz.conf", "/var/lib/foo", "/var/lib/foo/x", "/var/lib/qux"};
+
+	vector<bool> used;
+	vector<string> expected;
+	match_globs(cruft, globs, used, expected);
+
+	char file[] = "/tmp/test_memo.XXXXXX";
+	close(mkstemp(file));
+
+	bool ok = true;
+	for (int run = 0; run < 2; run++) {
+		verdict_cache cache(file, globs);
+		vector<string> cruft3;
+		cache.match_globs(cruft, globs, used, cruft3);
+		ok = ok && cache.save() && cruft3 == expected;
+		ok = ok && cache.hits == (run ? 4u : 0u) && cache.misses == (run ? 0u : 4u);
+		cout << "run " << run << ": " << cache.hits << " hits, " << cache.misses << " misses" << endl;
+	}
+
+	// a new entry in /etc
+	cruft.insert(cruft.begin() + 2, "/etc/bay.conf");
+	expected.insert(expected.begin() + 1, "/etc/bay.conf");
+	verdict_cache cache(file, globs);
+	vector<string> cruft3;
+	cache.match_globs(cruft, globs, used, cruft3);
+	ok = ok && cruft3 == expected && cache.hits == 3 && cache.misses == 1;
+
+	// other rules: nothing is reused
+	globs.pop_back();
+	verdict_cache other(file, globs);
+	cruft3.clear();
+	other.match_globs(cruft, globs, used, cruft3);
+	ok = ok && other.hits == 0;
+
+	unlink(file);
+	if (ok) {
+		cout << GREEN << "OK" << BLACK << endl;
+	} else {
+		cout << RED << "ERROR" << BLACK << endl;
+	}
+}
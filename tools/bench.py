@@ -0,0 +1,91 @@
+#!/usr/bin/python3
+
+# time each phase of cruft on synthetic systems of growing size,
+# see synthetic.py, and print the results as JSON:
+#
+#   ./tools/bench.py ./cruft --sizes 100,1000,10000 > bench.json
+
+import argparse
+import json
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+import synthetic
+
+# the phases of "cruft --format json", by what they do
+GROUPS = {
+    'scan': ['scan'],
+    'dpkg': ['dpkg', 'read excludes'],
+    'merge': ['main set match', 'missing2'],
+    'globs': ['read filters', 'extra vs globs'],
+    'explain': ['read explain', 'read explain uppercase', 'merge explain', 'extra vs explain'],
+    'output': ['report'],
+}
+
+
+def run(cruft, root):
+    start = time.monotonic()
+    out = subprocess.run([cruft, '--format', 'json'] + synthetic.command(root),
+                         stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, check=False)
+    wall = (time.monotonic() - start) * 1000
+    report = json.loads(out.stdout)
+    phases = {p['name']: p['ms'] for p in report['phases']}
+    return wall, phases, report['counts']
+
+
+def bench(cruft, packages, args):
+    root = tempfile.mkdtemp(prefix='cruft-bench-')
+    try:
+        start = time.monotonic()
+        generated = synthetic.generate(root, packages, **synthetic.options(args))
+        setup = (time.monotonic() - start) * 1000
+        walls = []
+        phases = {}
+        for _ in range(args.runs):
+            wall, times, counts = run(cruft, root)
+            walls.append(wall)
+            for name, ms in times.items():
+                phases.setdefault(name, []).append(ms)
+    finally:
+        shutil.rmtree(root)
+
+    # the median of the runs, the first one pays for a cold cache
+    median = {name: statistics.median(ms) for name, ms in sorted(phases.items())}
+    return {
+        'packages': packages,
+        'generated': generated,
+        'counts': counts,
+        'setup_ms': round(setup),
+        'wall_ms': round(statistics.median(walls)),
+        'phases': median,
+        'groups': {group: sum(median.get(name, 0) for name in names)
+                   for group, names in GROUPS.items()},
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description='benchmark cruft on synthetic systems')
+    parser.add_argument('binary', metavar='cruft', help='the cruft binary to time')
+    parser.add_argument('--sizes', default='100,1000,5000', help='numbers of packages, comma separated')
+    parser.add_argument('--runs', type=int, default=3, help='runs per size')
+    synthetic.add_arguments(parser)
+    args = parser.parse_args()
+
+    cruft = os.path.abspath(args.binary)
+    results = []
+    for packages in [int(size) for size in args.sizes.split(',')]:
+        print('%d packages' % packages, file=sys.stderr)
+        results.append(bench(cruft, packages, args))
+    json.dump({'benchmark': 'cruft', 'version': 1,
+               'options': dict(synthetic.options(args), runs=args.runs),
+               'results': results}, sys.stdout, indent=1)
+    print()
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,102 @@
+#!/usr/bin/python3
+
+# compare the scan backends on this host: plocate (bench-scan locate),
+# the mlocate.db reader (bench-scanold locate) and the directory walk
+# (bench-scan nolocate); print their costs and how their path sets
+# differ from the walk, as JSON:
+#
+#   make bench-scan bench-scanold && ./tools/bench_scan.py > bench-scan.json
+
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+# name, binary, argument
+BACKENDS = [
+    ('nolocate', 'bench-scan', 'nolocate'),
+    ('plocate', 'bench-scan', 'locate'),
+    ('mlocate', 'bench-scanold', 'locate'),
+]
+
+COSTS = ['wall_ms', 'user_ms', 'sys_ms', 'children_user_ms', 'children_sys_ms',
+         'max_rss_kb', 'children_max_rss_kb', 'read_syscalls', 'write_syscalls',
+         'voluntary_switches', 'involuntary_switches']
+
+
+def run(binary, backend, args, output):
+    command = [binary, '--ignore', args.ignore, '--output', output, backend]
+    if backend == 'nolocate':
+        command[1:1] = ['--root', args.root]
+    out = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                         universal_newlines=True, check=False)
+    if out.returncode != 0 or not out.stdout:
+        return None, out.stderr.strip()
+    return json.loads(out.stdout), None
+
+
+def paths(filename):
+    with open(filename, 'r', errors='surrogateescape') as lines:
+        return set(line.rstrip('\n') for line in lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='compare the cruft scan backends')
+    parser.add_argument('--bin', default='.', help='directory of bench-scan and bench-scanold')
+    parser.add_argument('--runs', type=int, default=3, help='runs per backend')
+    parser.add_argument('--ignore', default='/etc/cruft/ignore')
+    parser.add_argument('--root', default='/', help='root directory, for nolocate')
+    parser.add_argument('--diffs', type=int, default=20, help='differing paths to list')
+    args = parser.parse_args()
+
+    results = []
+    reference = None
+    with tempfile.TemporaryDirectory(prefix='cruft-scan-') as tmp:
+        for name, binary, backend in BACKENDS:
+            binary = os.path.join(args.bin, binary)
+            if not os.access(binary, os.X_OK):
+                results.append({'backend': name, 'skipped': '%s is not built' % binary})
+                continue
+            print(name, file=sys.stderr)
+            output = os.path.join(tmp, name)
+            runs = []
+            error = None
+            for _ in range(args.runs):
+                result, error = run(binary, backend, args, output)
+                if result is None:
+                    break
+                runs.append(result)
+            if not runs:
+                results.append({'backend': name, 'skipped': error})
+                continue
+
+            # the median of each cost; the first run pays for a cold cache
+            result = {'backend': name, 'paths': runs[0]['paths']}
+            for cost in COSTS:
+                result[cost] = statistics.median(r[cost] for r in runs)
+            found = paths(output)
+            if reference is None:
+                reference = (name, found)
+            else:
+                missing = sorted(reference[1] - found)
+                extra = sorted(found - reference[1])
+                result['compared_to'] = reference[0]
+                result['identical'] = not missing and not extra
+                result['only_in_reference'] = len(missing)
+                result['only_in_backend'] = len(extra)
+                result['examples_only_in_reference'] = missing[:args.diffs]
+                result['examples_only_in_backend'] = extra[:args.diffs]
+            results.append(result)
+
+    json.dump({'benchmark': 'cruft-scan', 'version': 1, 'runs': args.runs,
+               'results': results}, sys.stdout, indent=1)
+    print()
+    # a differing backend is a regression to look at
+    sys.exit(0 if all(r.get('identical', True) for r in results) else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,148 @@
+#!/usr/bin/python3
+
+# build a fake system to run "cruft --no-locate --root" against:
+# packages with their files, dpkg status and .list files,
+# cruft of three kinds (matched by the ruleset, by explain scripts,
+# or left unexplained) and some shipped files gone missing
+
+import argparse
+import os
+import random
+
+
+def tree(depth, fanout):
+    # the directories of a package below its own directory
+    dirs = ['']
+    level = ['']
+    for _ in range(depth):
+        level = ['%s/d%d' % (parent, i) for parent in level for i in range(fanout)]
+        dirs += level
+    return dirs
+
+
+def touch(root, path):
+    os.makedirs(os.path.dirname(root + path), exist_ok=True)
+    open(root + path, 'w').close()
+
+
+def parents(path):
+    parts = path.split('/')[1:-1]
+    return ['/' + '/'.join(parts[:i + 1]) for i in range(len(parts))]
+
+
+def generate(root, packages=100, files=20, cruft=0.1, missing=0.01,
+             depth=2, fanout=3, rules=4, wildcards=0.5, explain=0.2, seed=0):
+    root = root.rstrip('/')
+    rand = random.Random(seed)
+    dirs = tree(depth, fanout)
+    info = root + '/var/lib/dpkg/info'
+    os.makedirs(info, exist_ok=True)
+    os.makedirs(root + '/etc/cruft/filters', exist_ok=True)
+    os.makedirs(root + '/etc/cruft/explain', exist_ok=True)
+    open(root + '/ignore', 'w').close()
+    open(root + '/bugs', 'w').close()
+
+    counts = {'shipped': 0, 'missing': 0, 'ruled': 0, 'explained': 0, 'unexplained': 0}
+    with open(root + '/var/lib/dpkg/status', 'w') as status, \
+         open(root + '/ruleset', 'w') as ruleset:
+        for p in range(packages):
+            package = 'pkg%05d' % p
+            status.write('Package: %s\n'
+                         'Status: install ok installed\n'
+                         'Priority: optional\n'
+                         'Section: misc\n'
+                         'Maintainer: Nobody <nobody@example.org>\n'
+                         'Architecture: all\n'
+                         'Version: 1.0\n'
+                         'Description: synthetic package %d\n\n' % (package, p))
+
+            shipped = ['/etc/%s/%s.conf' % (package, package)]
+            for f in range(files - 1):
+                shipped.append('/usr/share/%s%s/f%d' % (package, dirs[f % len(dirs)], f))
+            listed = set()
+            for path in shipped:
+                listed.update(parents(path))
+            with open('%s/%s.list' % (info, package), 'w') as dpkg_list:
+                dpkg_list.write('/.\n')
+                for path in sorted(listed) + shipped:
+                    dpkg_list.write(path + '\n')
+            for path in shipped:
+                if rand.random() < missing:
+                    counts['missing'] += 1
+                else:
+                    touch(root, path)
+            counts['shipped'] += len(shipped)
+
+            # the rules: "/var/lib/<package>/state<n>", or a wildcard over a subdirectory
+            ruleset.write(package + '\n')
+            for r in range(rules):
+                if rand.random() < wildcards:
+                    ruleset.write('/var/lib/%s/w%d/*\n' % (package, r))
+                else:
+                    ruleset.write('/var/lib/%s/state%d\n' % (package, r))
+            has_explain = rand.random() < explain
+            explained = []
+            for c in range(int(files * cruft + rand.random())):
+                kind = c % 3
+                if kind == 0 and rules:
+                    r = c // 3 % rules
+                    path = '/var/lib/%s/state%d' % (package, r)
+                    touch(root, path)
+                    touch(root, '/var/lib/%s/w%d/c%d' % (package, r, c))
+                    counts['ruled'] += 1
+                elif kind == 1 and has_explain:
+                    path = '/var/cache/%s/c%d' % (package, c)
+                    touch(root, path)
+                    explained.append(path)
+                    counts['explained'] += 1
+                else:
+                    touch(root, '/usr/share/%s%s/leftover%d' % (package, dirs[c % len(dirs)], c))
+                    counts['unexplained'] += 1
+            if has_explain:
+                script = '%s/etc/cruft/explain/%s' % (root, package)
+                with open(script, 'w') as out:
+                    out.write('#!/bin/sh\n')
+                    for path in explained:
+                        out.write('echo %s\n' % path)
+                os.chmod(script, 0o755)
+    return counts
+
+
+def command(root):
+    root = root.rstrip('/')
+    return ['--no-locate', '--root', root + '/',
+            '--filter', root + '/etc/cruft/filters/',
+            '--explain', root + '/etc/cruft/explain/',
+            '--ruleset', root + '/ruleset',
+            '--bugs', root + '/bugs',
+            '--ignore', root + '/ignore']
+
+
+def add_arguments(parser):
+    parser.add_argument('--files', type=int, default=20, help='files per package')
+    parser.add_argument('--cruft', type=float, default=0.1, help='cruft files per shipped file')
+    parser.add_argument('--missing', type=float, default=0.01, help='ratio of shipped files not there')
+    parser.add_argument('--depth', type=int, default=2, help='directory depth inside a package')
+    parser.add_argument('--fanout', type=int, default=3, help='subdirectories per directory')
+    parser.add_argument('--rules', type=int, default=4, help='ruleset entries per package')
+    parser.add_argument('--wildcards', type=float, default=0.5, help='ratio of rules with a wildcard')
+    parser.add_argument('--explain', type=float, default=0.2, help='ratio of packages with an explain script')
+    parser.add_argument('--seed', type=int, default=0)
+
+
+def options(args):
+    return dict(files=args.files, cruft=args.cruft, missing=args.missing,
+                depth=args.depth, fanout=args.fanout, rules=args.rules,
+                wildcards=args.wildcards, explain=args.explain, seed=args.seed)
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='build a synthetic system for cruft')
+    parser.add_argument('root')
+    parser.add_argument('--packages', type=int, default=100)
+    add_arguments(parser)
+    args = parser.parse_args()
+    counts = generate(args.root, args.packages, **options(args))
+    for key, value in counts.items():
+        print('%s: %d' % (key, value))
+    print('cruft ' + ' '.join(command(args.root)))
@@ -0,0 +1,328 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+using namespace std;
+
+struct span_record
+{
+	string name;
+	int thread;
+	trace_span::snapshot begin;
+	trace_span::snapshot end;
+};
+
+static atomic<bool> enabled{false};
+static string trace_path;
+static chrono::steady_clock::time_point started;
+static mutex records_lock;
+static vector<span_record> records;
+
+static atomic<bool> counting{false};
+static atomic<size_t> scanned{0};
+
+static const struct
+{
+	const char* name;
+	uint32_t type;
+	uint64_t config;
+} counter_events[trace_counters] = {
+	{"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{"cache_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+	{"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+	{"context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+// the counters of one thread, opened on its first span
+struct thread_counters
+{
+	int fd[trace_counters];
+	bool opened = false;
+
+	void open()
+	{
+		opened = true;
+		for (int i = 0; i < trace_counters; i++) {
+			struct perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = counter_events[i].type;
+			attr.config = counter_events[i].config;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			attr.exclude_hv = 1;
+			// only this thread, on any CPU
+			fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+			if (fd[i] < 0 && (errno == EACCES || errno == EPERM)) {
+				// perf_event_paranoid 2: user space only
+				attr.exclude_kernel = 1;
+				fd[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+			}
+		}
+	}
+
+	void read(long long counters[trace_counters])
+	{
+		if (!opened)
+			open();
+		for (int i = 0; i < trace_counters; i++) {
+			uint64_t value[3]; // value, time enabled, time running
+			counters[i] = -1;
+			if (fd[i] < 0 || ::read(fd[i], value, sizeof(value)) != sizeof(value) || value[2] == 0)
+				continue;
+			// scaled up when the PMU was shared with other counters
+			counters[i] = value[2] < value[1] ? (long long)(double(value[0]) * value[1] / value[2]) : value[0];
+		}
+	}
+
+	~thread_counters()
+	{
+		if (opened)
+			for (int i = 0; i < trace_counters; i++)
+				if (fd[i] >= 0)
+					close(fd[i]);
+	}
+};
+
+static atomic<int> threads{0};
+static thread_local thread_counters counters;
+static thread_local int thread_id = -1;
+static thread_local bool stepped = false;
+static thread_local trace_span::snapshot last_step;
+
+// small numbers, in order of first use: the main thread is 0
+static int this_thread()
+{
+	if (thread_id < 0)
+		thread_id = threads++;
+	return thread_id;
+}
+
+static long us(const timeval& tv)
+{
+	return tv.tv_sec * 1000000L + tv.tv_usec;
+}
+
+static trace_span::snapshot now()
+{
+	trace_span::snapshot s;
+	s.wall_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - started).count();
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	s.cpu_us = ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+	// only the children already waited for, of all the threads
+	struct rusage ru;
+	getrusage(RUSAGE_CHILDREN, &ru);
+	s.children_us = us(ru.ru_utime) + us(ru.ru_stime);
+	getrusage(RUSAGE_SELF, &ru);
+	s.max_rss_kb = ru.ru_maxrss;
+	if (counting)
+		counters.read(s.counters);
+	else
+		fill(s.counters, s.counters + trace_counters, -1);
+	return s;
+}
+
+static void record(const string& name, const trace_span::snapshot& begin, const trace_span::snapshot& end)
+{
+	lock_guard<mutex> lock(records_lock);
+	records.push_back({name, this_thread(), begin, end});
+}
+
+void trace_start(const string& trace_file)
+{
+	trace_path = trace_file;
+	if (trace_path.empty() && getenv("CRUFT_TRACE"))
+		trace_path = getenv("CRUFT_TRACE");
+	counting = getenv("COUNTERS") != nullptr;
+	if (trace_path.empty() && getenv("ELAPSED") == nullptr && !counting)
+		return;
+	started = chrono::steady_clock::now();
+	this_thread();
+	last_step = now();
+	stepped = true;
+	enabled = true;
+}
+
+trace_span::trace_span(const string& name_) : name(name_), enabled(::enabled)
+{
+	if (enabled)
+		begin = now();
+}
+
+trace_span::~trace_span()
+{
+	if (enabled)
+		record(name, begin, now());
+}
+
+void trace_paths(size_t paths)
+{
+	scanned = paths;
+}
+
+void trace_step(const string& name)
+{
+	if (!enabled)
+		return;
+	auto end = now();
+	if (stepped)
+		record(name, last_step, end);
+	last_step = end;
+	stepped = true;
+}
+
+static void print_table(const vector<span_record>& spans)
+{
+	char line[256];
+	snprintf(line, sizeof(line), "%-24s %6s %9s %9s %9s %9s %9s\n",
+	         "phase", "thread", "start ms", "wall ms", "cpu ms", "child ms", "rss +kB");
+	cerr << line;
+	for (const auto& s: spans) {
+		snprintf(line, sizeof(line), "%-24.24s %6d %9ld %9ld %9ld %9ld %9ld\n",
+		         s.name.c_str(), s.thread,
+		         s.begin.wall_us / 1000,
+		         (s.end.wall_us - s.begin.wall_us) / 1000,
+		         (s.end.cpu_us - s.begin.cpu_us) / 1000,
+		         (s.end.children_us - s.begin.children_us) / 1000,
+		         s.end.max_rss_kb - s.begin.max_rss_kb);
+		cerr << line;
+	}
+}
+
+static long long delta(const span_record& s, int counter)
+{
+	if (s.begin.counters[counter] < 0 || s.end.counters[counter] < 0)
+		return -1;
+	return s.end.counters[counter] - s.begin.counters[counter];
+}
+
+// '-' when the kernel would not give the counter
+static string column(long long value, double scale = 1)
+{
+	return value < 0 ? "-" : to_string((long long)(value / scale));
+}
+
+static void print_counters(const vector<span_record>& spans)
+{
+	bool any = false;
+	for (const auto& s: spans)
+		for (int i = 0; i < trace_counters; i++)
+			any |= delta(s, i) >= 0;
+	if (!any) {
+		cerr << "no performance counters available, see /proc/sys/kernel/perf_event_paranoid\n";
+		return;
+	}
+
+	char line[256];
+	snprintf(line, sizeof(line), "%-24s %9s %9s %5s %9s %9s %7s %6s %9s %9s\n",
+	         "phase", "Mcycles", "Minstr", "IPC", "cache-mis", "branch-mi", "faults", "cs",
+	         "cyc/path", "ins/path");
+	cerr << line;
+	for (const auto& s: spans) {
+		long long cycles = delta(s, counter_cycles), instructions = delta(s, counter_instructions);
+		string ipc = cycles > 0 && instructions >= 0 ? to_string(double(instructions) / cycles).substr(0, 4) : "-";
+		snprintf(line, sizeof(line), "%-24.24s %9s %9s %5s %9s %9s %7s %6s %9s %9s\n",
+		         s.name.c_str(),
+		         column(cycles, 1e6).c_str(), column(instructions, 1e6).c_str(), ipc.c_str(),
+		         column(delta(s, counter_cache_misses)).c_str(),
+		         column(delta(s, counter_branch_misses)).c_str(),
+		         column(delta(s, counter_page_faults)).c_str(),
+		         column(delta(s, counter_context_switches)).c_str(),
+		         scanned ? column(cycles, scanned).c_str() : "-",
+		         scanned ? column(instructions, scanned).c_str() : "-");
+		cerr << line;
+	}
+}
+
+static string quoted(const string& s)
+{
+	string out = "\"";
+	for (unsigned char c: s) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (c < 0x20) {
+			char esc[8];
+			snprintf(esc, sizeof(esc), "\\u%04x", c);
+			out += esc;
+		} else {
+			out += c;
+		}
+	}
+	return out + '"';
+}
+
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+static bool write_trace(const vector<span_record>& spans)
+{
+	string tmp = trace_path + ".tmp";
+	ofstream out(tmp, ios::trunc);
+	int pid = getpid();
+	out << "{\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":0,\"args\":{\"name\":"
+	    << quoted(program_invocation_short_name) << "}}";
+	for (int t = 0; t < threads; t++)
+		out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << t
+		    << ",\"args\":{\"name\":\"" << (t ? "worker " + to_string(t) : "main") << "\"}}";
+	for (const auto& s: spans) {
+		out << ",\n{\"name\":" << quoted(s.name) << ",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << s.thread
+		    << ",\"ts\":" << s.begin.wall_us << ",\"dur\":" << s.end.wall_us - s.begin.wall_us
+		    << ",\"args\":{\"cpu_ms\":" << (s.end.cpu_us - s.begin.cpu_us) / 1000.0
+		    << ",\"children_cpu_ms\":" << (s.end.children_us - s.begin.children_us) / 1000.0
+		    << ",\"rss_growth_kb\":" << s.end.max_rss_kb - s.begin.max_rss_kb
+		    << ",\"max_rss_kb\":" << s.end.max_rss_kb;
+		for (int i = 0; i < trace_counters; i++)
+			if (delta(s, i) >= 0)
+				out << ",\"" << counter_events[i].name << "\":" << delta(s, i);
+		long long cycles = delta(s, counter_cycles), instructions = delta(s, counter_instructions);
+		if (cycles > 0 && instructions >= 0)
+			out << ",\"ipc\":" << double(instructions) / cycles;
+		if (scanned && cycles >= 0)
+			out << ",\"cycles_per_path\":" << double(cycles) / scanned;
+		out << "}}";
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	out.close();
+	if (!out || rename(tmp.c_str(), trace_path.c_str()) != 0) {
+		cerr << "cannot write " << trace_path << ": " << strerror(errno) << '\n';
+		unlink(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool trace_end()
+{
+	if (!enabled)
+		return true;
+	vector<span_record> spans;
+	{
+		lock_guard<mutex> lock(records_lock);
+		spans = records;
+	}
+	if (getenv("ELAPSED"))
+		print_table(spans);
+	if (counting)
+		print_counters(spans);
+	return trace_path.empty() || write_trace(spans);
+}
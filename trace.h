@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/* what each phase costs: wall time, CPU time of the thread that runs
+   it, CPU time of the children reaped meanwhile and growth of the peak
+   RSS of the process; printed as a table on stderr when ELAPSED is set,
+   and written as Chrome trace events (chrome://tracing, Perfetto) when
+   there is a trace file; does nothing before trace_start()
+
+   with COUNTERS set, also the hardware and software counters of the
+   thread from perf_event_open(), those the kernel lets us open */
+void trace_start(const std::string& trace_file);
+// prints and writes what was recorded; false if the trace file cannot be written
+bool trace_end();
+// the number of paths gone through, to print the counters per path
+void trace_paths(size_t paths);
+
+enum trace_counter
+{
+	counter_cycles,
+	counter_instructions,
+	counter_cache_misses,
+	counter_branch_misses,
+	counter_page_faults,
+	counter_context_switches,
+	trace_counters
+};
+
+// one phase, from construction to destruction
+class trace_span
+{
+public:
+	explicit trace_span(const std::string& name);
+	~trace_span();
+	trace_span(const trace_span&) = delete;
+	trace_span& operator=(const trace_span&) = delete;
+
+	struct snapshot
+	{
+		long wall_us;
+		long cpu_us;
+		long children_us;
+		long max_rss_kb;
+		long long counters[trace_counters];   // -1 if not available
+	};
+
+private:
+	std::string name;
+	snapshot begin;
+	bool enabled;
+};
+
+// one phase of this thread, from its previous trace_step() or trace_start()
+void trace_step(const std::string& name);
@@ -4,12 +4,13 @@
 #include <cstring>
 #include <iostream>
 #include <sys/stat.h>
+#include "counters.h"
 #include "usr_merge.h"
 
 static bool check_link(const string& path, const bool mandatory)
 {
 	struct stat file_info;
-	if (lstat(path.c_str(), &file_info) < 0) {
+	if (counted_lstat(path.c_str(), &file_info) < 0) {
 		if (mandatory) cerr << "Failed to stat '" << path << "': " << strerror(errno) << '\n';
 		return false;
 	}
@@ -18,13 +19,8 @@ static bool check_link(const string& path, const bool mandatory)
 
 string usr_merge(const string& path)
 {
-	static bool setup = false;
-	static bool MERGED;
-	if (!setup)
-	{
-		MERGED=check_link("/bin", true);
-		setup=true;
-	}
+	// thread-safe one-time initialisation
+	static const bool MERGED = check_link("/bin", true);
 
 	if (MERGED and (path.rfind("/bin/", 0) == 0
 			or path.rfind("/lib/", 0) == 0
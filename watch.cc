@@ -0,0 +1,124 @@
+// Copyright © 2026 Alexandre Detiste <alexandre@detiste.be>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// new code: do not attempt to support Buster or Hurd
+
+#include <climits>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/fanotify.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#include "mounts.h"
+#include "watch.h"
+
+using namespace std;
+
+static const uint64_t events = FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_ONDIR;
+
+static uint64_t fsid_of(const int val[2])
+{
+	return uint64_t(uint32_t(val[0])) << 32 | uint32_t(val[1]);
+}
+
+fs_watch::~fs_watch()
+{
+	for (const auto& fs: filesystems)
+		close(fs.fd);
+	if (fan >= 0)
+		close(fan);
+}
+
+bool fs_watch::start(const string& root_dir)
+{
+	root = root_dir.substr(0, root_dir.size() - 1);
+
+	fan = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_LARGEFILE);
+	if (fan < 0) {
+		cerr << "fanotify_init: " << strerror(errno) << '\n';
+		return false;
+	}
+
+	vector<mount> mounts;
+	if (read_mounts(mounts, root_dir) != 0)
+		return false;
+	for (const auto& m: mounts) {
+		string point = root + m.point;
+		if (point.empty())
+			point = "/";
+		int fd = open(point.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		struct statfs st;
+		if (fd < 0 || fstatfs(fd, &st) != 0
+		    || fanotify_mark(fan, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, events, AT_FDCWD, point.c_str()) != 0) {
+			cerr << "cannot watch " << point << ": " << strerror(errno) << '\n';
+			if (fd >= 0) close(fd);
+			return false;
+		}
+		// bind mounts of one filesystem share one mark
+		filesystems.push_back({fsid_of(st.f_fsid.__val), fd});
+	}
+	return true;
+}
+
+bool fs_watch::read(vector<fs_change>& changes)
+{
+	bool complete = true;
+	alignas(fanotify_event_metadata) char buf[64 * 1024];
+	for (;;) {
+		ssize_t len = ::read(fan, buf, sizeof(buf));
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			break; // EAGAIN: drained
+
+		auto meta = reinterpret_cast<const fanotify_event_metadata*>(buf);
+		for (; FAN_EVENT_OK(meta, len); meta = FAN_EVENT_NEXT(meta, len)) {
+			if (meta->mask & FAN_Q_OVERFLOW) {
+				complete = false;
+				continue;
+			}
+			auto fid = reinterpret_cast<const fanotify_event_info_fid*>(meta + 1);
+			if (meta->event_len < sizeof(*meta) + sizeof(*fid)
+			    || fid->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+				continue;
+			auto handle = reinterpret_cast<struct file_handle*>(const_cast<unsigned char*>(fid->handle));
+			const char* name = reinterpret_cast<const char*>(handle->f_handle + handle->handle_bytes);
+
+			uint64_t fsid = fsid_of(fid->fsid.val);
+			int mount_fd = -1;
+			for (const auto& fs: filesystems)
+				if (fs.fsid == fsid)
+					mount_fd = fs.fd;
+			if (mount_fd < 0)
+				continue;
+
+			// the directory may be gone already, its removal comes as an event too
+			int dir = open_by_handle_at(mount_fd, handle, O_PATH | O_CLOEXEC);
+			if (dir < 0)
+				continue;
+			char link[PATH_MAX];
+			string proc = "/proc/self/fd/" + to_string(dir);
+			ssize_t n = readlink(proc.c_str(), link, sizeof(link) - 1);
+			close(dir);
+			if (n <= 0)
+				continue;
+			string path(link, n);
+			if (path.compare(0, root.size(), root) != 0 || (path.size() > root.size() && path[root.size()] != '/'))
+				continue; // outside the root, on a watched filesystem
+			path.erase(0, root.size());
+			if (strcmp(name, ".") != 0)
+				path += (path.empty() || path.back() != '/' ? "/" : "") + string(name);
+			if (path.empty())
+				path = "/";
+
+			struct stat st;
+			bool exists = lstat((root + path).c_str(), &st) == 0;
+			changes.push_back({path, exists, exists ? S_ISDIR(st.st_mode) : (meta->mask & FAN_ONDIR) != 0});
+		}
+	}
+	return complete;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// a path created, deleted or renamed, relative to the root directory
+struct fs_change
+{
+	std::string path;
+	bool exists;      // as seen when the event is read
+	bool directory;
+};
+
+/* the create, delete and rename events of all the filesystems
+   mounted below a root directory, through fanotify;
+   needs CAP_SYS_ADMIN and Linux 5.9 */
+class fs_watch
+{
+public:
+	fs_watch() = default;
+	~fs_watch();
+	fs_watch(const fs_watch&) = delete;
+	fs_watch& operator=(const fs_watch&) = delete;
+
+	// false, with a message on stderr, if the filesystems cannot be watched
+	bool start(const std::string& root_dir);
+	// becomes readable when there are events
+	int fd() const { return fan; }
+	// the changes queued so far; false if the kernel dropped some
+	bool read(std::vector<fs_change>& changes);
+
+private:
+	struct filesystem
+	{
+		uint64_t fsid;
+		int fd;
+	};
+	int fan = -1;
+	std::string root;    // without the trailing '/'
+	std::vector<filesystem> filesystems;
+};